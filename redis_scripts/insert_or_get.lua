@@ -0,0 +1,45 @@
+-- Claims states for the visited set, or returns the IDs they already have
+--
+-- KEYS[1]  hash of the visited set: first hash of a state -> "id:second hash"
+-- KEYS[2]  counter the IDs are taken from
+-- KEYS[3]  set of the first hashes that collided
+-- KEYS[4]  counter of the claimed states not expanded yet, see take_work.lua
+-- ARGV     first hash, second hash, first hash, second hash, ... of each state
+--
+-- A state whose first hash is taken by another state is stored under
+-- "hash_1", "hash_2", ... instead, whichever is free or holds the state.
+--
+-- Returns id, claimed, id, claimed, ... with claimed 1 if this call added the
+-- state, in the order of ARGV. A claimed state counts as pending work until
+-- the caller has expanded it.
+
+local result = {}
+for i = 1, #ARGV, 2 do
+    local hash = ARGV[i]
+    local check = ARGV[i + 1]
+    local field = hash
+    local count = 0
+    while true do
+        local entry = redis.call("hget", KEYS[1], field)
+        if not entry then
+            local id = redis.call("incr", KEYS[2]) - 1
+            redis.call("hset", KEYS[1], field, id .. ":" .. check)
+            redis.call("incr", KEYS[4])
+            if count > 0 then
+                redis.call("sadd", KEYS[3], hash)
+            end
+            result[#result + 1] = id
+            result[#result + 1] = 1
+            break
+        end
+        local sep = string.find(entry, ":", 1, true)
+        if string.sub(entry, sep + 1) == check then
+            result[#result + 1] = tonumber(string.sub(entry, 1, sep - 1))
+            result[#result + 1] = 0
+            break
+        end
+        count = count + 1
+        field = hash .. "_" .. count
+    end
+end
+return result
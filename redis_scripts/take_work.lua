@@ -0,0 +1,43 @@
+-- Hands out the claimed states of a shared run for expansion, and tells when
+-- the run is over
+--
+-- KEYS[1]  list of the claimed states waiting to be expanded
+-- KEYS[2]  counter of the claimed states not expanded yet, see insert_or_get.lua
+-- KEYS[3]  the limit that stopped the run, if one did
+-- ARGV[1]  number of states the caller expanded since its last call
+-- ARGV[2]  most states to take
+-- ARGV[3]  limit the caller reached, or ""
+-- ARGV[4]  ...  states the caller claimed since its last call
+--
+-- The claimed states are added to the list first, so the counter never drops
+-- to 0 while one is waiting. Returns "stop" and the limit once any caller has
+-- reached one, "done" once every claimed state was expanded, or "work" and
+-- the states taken, which may be none while other callers are still
+-- expanding states.
+
+local expanded = tonumber(ARGV[1])
+local count = tonumber(ARGV[2])
+if ARGV[3] ~= "" then
+    redis.call("setnx", KEYS[3], ARGV[3])
+end
+for i = 4, #ARGV do
+    redis.call("rpush", KEYS[1], ARGV[i])
+end
+local pending = redis.call("decrby", KEYS[2], expanded)
+
+local reason = redis.call("get", KEYS[3])
+if reason then
+    return {"stop", reason}
+end
+if pending <= 0 then
+    return {"done"}
+end
+local result = {"work"}
+for i = 1, count do
+    local entry = redis.call("lpop", KEYS[1])
+    if not entry then
+        break
+    end
+    result[#result + 1] = entry
+end
+return result
@@ -1,11 +1,12 @@
 CREATE TABLE factbase (
   id SERIAL PRIMARY KEY,
-  hash TEXT
+  hash TEXT,
+  depth INTEGER -- exploits on the path the state was first reached by
 );
 
 CREATE TABLE factbase_item (
   factbase_id INTEGER REFERENCES factbase(id),
-  f BIGINT,
+  f NUMERIC(39),
   type TEXT,
   PRIMARY KEY (factbase_id, f, type)
 );
@@ -77,6 +78,11 @@ CREATE TABLE edge_asset_binding (
   asset_id INTEGER REFERENCES asset(id)
 );
 
+-- States that were found but not expanded when a limit stopped generation
+CREATE TABLE frontier (
+  factbase_id INTEGER REFERENCES factbase(id)
+);
+
 CREATE TABLE keyvalue (
   id INTEGER PRIMARY KEY,
   property TEXT
@@ -2,283 +2,1423 @@
 // an attack graph's exploits and printing them
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "ag_gen.h"
+#include "dominance.h"
 
+#include "util/arena.h"
+#include "util/thread_pool.h"
+#include "util/work_deque.h"
 #include "util/odometer.h"
 #include "util/db_functions.h"
+#include "util/memory_usage.h"
+
+/**
+ * @brief Fills in the asset IDs of an instance that was not decomposed
+ * @details Instances built by decompose_instance() only hold a subset of the
+ * assets, so permutations are taken over asset_ids rather than 0..n-1. Also
+ * checks that the instance's fact layout can encode every asset and fact.
+ */
+void AGGen::init_asset_ids() {
+    if (instance.asset_ids.empty()) {
+        instance.asset_ids.resize(instance.assets.size());
+        std::iota(instance.asset_ids.begin(), instance.asset_ids.end(), 0);
+    }
+
+    size_t num_assets = instance.asset_ids.empty()
+        ? 0 : *std::max_element(instance.asset_ids.begin(), instance.asset_ids.end()) + 1;
+    if (!instance.layout.fits(num_assets, instance.facts.size()))
+        throw std::length_error("Fact layout too narrow for the model, use FactLayout::choose()");
+}
 
 #ifdef REDIS
 
 /**
- * @brief Constructor for generator
- * @details Builds a generator for creating attack graphs.
+ * @brief Constructor for a generator that shares its visited set in Redis
+ * @details The initial state is claimed in the shared set like any other
+ *          state. If another process sharing the set has claimed it already,
+ *          this one helps expanding the states of that run (see
+ *          expand_redis()), and stores only the states it claims.
  *
  * @param _instance The initial information for generating the graph
+ * @param _rman The shared visited set
  */
-AGGen::AGGen(AGGenInstance &_instance, RedisManager &_rman) : instance(_instance), rman(&_rman) {
-    rman->clear();
-    auto init_quals = instance.initial_qualities;
-    auto init_topos = instance.initial_topologies;
-    NetworkState init_state(init_quals, init_topos);
-    init_state.set_id();
-    int init_id = init_state.get_id();
-    FactbaseItems init_items =
-                make_tuple(make_tuple(init_quals, init_topos), init_id);
-    instance.factbases.push_back(init_state.get_factbase());
-    instance.factbase_items.push_back(init_items);
-    std::string hash = std::to_string(init_state.get_hash(instance.facts));
-    // std::cout << "before init insertion" << std::endl;
-    rman->insert_factbase(hash, init_id);
-    // rman->insert_facts(hash, init_quals, init_topos);
-    rman->commit();
-    // std::cout << "after init insertion" << std::endl;
-    // hash_map.insert(std::make_pair(init_state.get_hash(instance.facts), init_id));
-    frontier.push_back(init_state);
+AGGen::AGGen(const AGGenInstance &_instance, RedisManager &_rman)
+    : instance(_instance), selectivity(instance.exploits), rman(&_rman) {
+    init_asset_ids();
+    NetworkState init_state(instance.initial_qualities, instance.initial_topologies, instance.layout);
+    auto claim = rman->insert_or_get(
+        {{init_state.get_hash(), init_state.get_factbase().hash(RedisManager::CHECK_SEED)}})[0];
+    init_state.set_id(claim.first);
+    if (claim.second) {
+        instance.factbases.push_back(init_state.get_factbase());
+        instance.factbase_items.emplace_back(init_state.get_factbase().get_facts_tuple(), claim.first);
+        frontier.push_back(std::move(init_state));
+    }
     use_redis = true;
 }
 
 #endif
 
-AGGen::AGGen(AGGenInstance &_instance) : instance(_instance) {
-    auto init_quals = instance.initial_qualities;
-    auto init_topos = instance.initial_topologies;
-    NetworkState init_state(init_quals, init_topos);//instantiate an obj init_state with initial input
+AGGen::AGGen(const AGGenInstance &_instance) : instance(_instance), selectivity(instance.exploits) {
+    init_asset_ids();
+    const auto &init_quals = instance.initial_qualities;
+    const auto &init_topos = instance.initial_topologies;
+    NetworkState init_state(init_quals, init_topos, instance.layout);//instantiate an obj init_state with initial input
     init_state.set_id();
     int init_id = init_state.get_id();
-    FactbaseItems init_items =
-                make_tuple(make_tuple(init_quals, init_topos), init_id);
     instance.factbases.push_back(init_state.get_factbase());
-    instance.factbase_items.push_back(init_items);
-    std::string hash = std::to_string(init_state.get_hash(instance.facts));
-    hash_map.insert(std::make_pair(init_state.get_hash(instance.facts), init_id));
-    frontier.push_back(init_state);
+    instance.factbase_items.emplace_back(init_state.get_factbase().get_facts_tuple(), init_id);
+    visited.insert_or_get(init_state.get_hash(), [&] { return init_id; });
+    frontier.push_back(std::move(init_state));
     use_redis = false;
 }
 
 /**
- * @brief Generates exploit postconditions
- * @details When an exploit is known to apply to a set of assets,
- * the postconditions must be generated. This is done by iterating
- * through each parameterized fact and inserting the applicable
- * assets.
+ * @brief Parses the comparison of a precondition
+ * @details An empty operator, as written for a bare topology, means equality.
+ *          The exploit grammar also accepts operators that are not
+ *          comparisons in a precondition, such as +=, -= and <-. Those were
+ *          always checked as equality, and still are.
+ */
+static OPERATION_T parse_operation(const std::string &op) {
+    if (op == ">=")
+        return GEQ_T;
+    if (op == "<=")
+        return LEQ_T;
+    if (op == ">")
+        return GT_T;
+    if (op == "<")
+        return LT_T;
+    if (op == "!=" || op == "<>")
+        return NEQ_T;
+    return EQ_T;
+}
+
+/**
+ * @brief Every value a single attribute or property takes in a model
+ */
+struct AttributeValues {
+    std::vector<int> ids;                        //!< Keyvalue IDs of all values
+    std::vector<std::pair<double, int>> numeric; //!< Numeric values, sorted
+};
+
+using ValueIndex = std::unordered_map<int, AttributeValues>;
+
+/**
+ * @brief Indexes the values of every attribute and property
+ * @details A fact can only ever hold a value that appears in the initial
+ *          facts or in a postcondition, so those are the candidates for a
+ *          comparison. Numeric values are sorted, so a range comparison
+ *          selects a contiguous slice of them.
+ */
+static ValueIndex index_values(const AGGenInstance &instance) {
+    const Keyvalue &facts = instance.facts;
+    ValueIndex index;
+    auto add = [&](const std::string &attr, const std::string &value) {
+        index[facts[attr]].ids.push_back(facts[value]);
+    };
+
+    for (const auto &qual : instance.initial_qualities)
+        add(qual.get_name(), qual.get_value());
+    for (const auto &topo : instance.initial_topologies)
+        add(topo.get_property(), topo.get_value());
+    for (const auto &ex : instance.exploits) {
+        for (const auto &postcond : ex.postcond_list_q())
+            add(std::get<1>(postcond).name, std::get<1>(postcond).value);
+        for (const auto &postcond : ex.postcond_list_t())
+            add(std::get<1>(postcond).get_property(), std::get<1>(postcond).get_value());
+    }
+
+    for (auto &entry : index) {
+        auto &values = entry.second;
+        std::sort(values.ids.begin(), values.ids.end());
+        values.ids.erase(std::unique(values.ids.begin(), values.ids.end()), values.ids.end());
+        for (int id : values.ids) {
+            if (facts.is_number(id))
+                values.numeric.emplace_back(facts.number(id), id);
+        }
+        std::sort(values.numeric.begin(), values.numeric.end());
+    }
+    return index;
+}
+
+/**
+ * @brief Compiles a comparison into the set of values that satisfy it
  *
- * @param group A tuple containing the exploit and applicable assets
- * @return A tuple containing the "real" qualities and "real" topologies
+ * @param index The value index of the model
+ * @param attr Keyvalue ID of the attribute or property compared
+ * @param op The comparison, anything but EQ_T
+ * @param value The value compared against, as written in the exploit
+ * @return Sorted Keyvalue IDs of the values that satisfy the comparison
  */
-static std::tuple<std::vector<std::tuple<ACTION_T, Quality>>, std::vector<std::tuple<ACTION_T, Topology>>>
-createPostConditions(std::tuple<Exploit, AssetGroup> &group, Keyvalue &facts) {
-    auto ex = std::get<0>(group);
-    auto ag = std::get<1>(group);
+static std::shared_ptr<const std::vector<int>> compile_comparison(const ValueIndex &index, int attr,
+                                                                  OPERATION_T op,
+                                                                  const std::string &value,
+                                                                  const Keyvalue &facts) {
+    auto result = std::make_shared<std::vector<int>>();
+    auto it = index.find(attr);
+    if (it == index.end())
+        return result;
+    const auto &values = it->second;
+
+    if (op == NEQ_T) {
+        int id = facts.find(value);
+        for (int other : values.ids) {
+            if (other != id)
+                result->push_back(other);
+        }
+        return result;
+    }
 
-    auto perm = ag.get_perm();
+    // Values that are not numbers have no order, so they are only matched
+    // for equality, as every precondition was before comparisons
+    char *end = nullptr;
+    double threshold = std::strtod(value.c_str(), &end);
+    if (value.empty() || end != value.c_str() + value.size()) {
+        int id = facts.find(value);
+        if (std::find(values.ids.begin(), values.ids.end(), id) != values.ids.end())
+            result->push_back(id);
+        return result;
+    }
 
-    auto param_postconds_q = ex.postcond_list_q();
-    auto param_postconds_t = ex.postcond_list_t();
+    const auto &numeric = values.numeric;
+    auto below = [](const std::pair<double, int> &v, double t) { return v.first < t; };
+    auto above = [](double t, const std::pair<double, int> &v) { return t < v.first; };
+    auto first = numeric.begin();
+    auto last = numeric.end();
+    switch (op) {
+    case LT_T:
+        last = std::lower_bound(numeric.begin(), numeric.end(), threshold, below);
+        break;
+    case LEQ_T:
+        last = std::upper_bound(numeric.begin(), numeric.end(), threshold, above);
+        break;
+    case GT_T:
+        first = std::upper_bound(numeric.begin(), numeric.end(), threshold, above);
+        break;
+    case GEQ_T:
+        first = std::lower_bound(numeric.begin(), numeric.end(), threshold, below);
+        break;
+    default:
+        break;
+    }
 
-    std::vector<std::tuple<ACTION_T, Quality>> postconds_q;
-    std::vector<std::tuple<ACTION_T, Topology>> postconds_t;
+    for (; first != last; ++first)
+        result->push_back(first->second);
+    std::sort(result->begin(), result->end());
+    return result;
+}
 
-    for (auto &postcond : param_postconds_q) {
-        auto action = std::get<0>(postcond);
-        auto fact = std::get<1>(postcond);
+/**
+ * @brief Asset pairs that can satisfy a topology precondition
+ * @details by_from holds (from, to) pairs sorted by the from asset, and
+ *          by_to holds the same pairs as (to, from), sorted by the to asset.
+ */
+struct Links {
+    std::vector<std::pair<size_t, size_t>> by_from;
+    std::vector<std::pair<size_t, size_t>> by_to;
+};
 
-        Quality q(perm[fact.get_param_num()], fact.name, "=",
-                  fact.value, facts);
-        postconds_q.emplace_back(action, q);
+/**
+ * @brief Links of the model's topologies, keyed by property and direction
+ */
+struct AdjacencyIndex {
+    std::map<std::pair<int, DIRECTION_T>, Links> links;
+    std::unordered_set<int> added; //!< Properties a postcondition may add links for
+};
+
+/**
+ * @brief Indexes the initial topologies by property and direction
+ * @details Topologies are normalized to forward facts the same way a Factbase
+ *          stores them, so a bidirectional link shows up in both directions.
+ *          A precondition from a to b is satisfied by the forward link a->b,
+ *          the backward link b->a, or the bidirectional pair of both. Only a
+ *          postcondition that adds a topology can create a link, so for every
+ *          other property the index holds all links any state will ever have.
+ */
+static AdjacencyIndex index_adjacency(const AGGenInstance &instance) {
+    const FactLayout &layout = instance.layout;
+    AdjacencyIndex index;
+    std::unordered_map<int, std::vector<std::pair<size_t, size_t>>> forward;
+    for (const auto &topo : instance.initial_topologies) {
+        for (auto fact : topo.encode(layout)) {
+            DecodedTopology t = layout.decode_topology(fact);
+            forward[t.property].emplace_back(t.from_asset, t.to_asset);
+        }
+    }
+
+    auto add = [&](int property, DIRECTION_T dir, std::vector<std::pair<size_t, size_t>> pairs) {
+        Links &links = index.links[std::make_pair(property, dir)];
+        links.by_from = std::move(pairs);
+        for (auto &pair : links.by_from)
+            links.by_to.emplace_back(pair.second, pair.first);
+        std::sort(links.by_to.begin(), links.by_to.end());
+    };
+    for (auto &entry : forward) {
+        auto &pairs = entry.second;
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+        std::vector<std::pair<size_t, size_t>> reversed, both;
+        for (auto &pair : pairs) {
+            reversed.emplace_back(pair.second, pair.first);
+            if (std::binary_search(pairs.begin(), pairs.end(), reversed.back()))
+                both.push_back(pair);
+        }
+        std::sort(reversed.begin(), reversed.end());
+        add(entry.first, FORWARD_T, pairs);
+        add(entry.first, BACKWARD_T, std::move(reversed));
+        add(entry.first, BIDIRECTION_T, std::move(both));
+    }
+
+    for (const auto &ex : instance.exploits) {
+        for (const auto &postcond : ex.postcond_list_t()) {
+            if (std::get<0>(postcond) == ADD_T)
+                index.added.insert(instance.facts[std::get<1>(postcond).get_property()]);
+        }
+    }
+    return index;
+}
+
+/**
+ * @brief Enumerates the asset bindings of an exploit worth grounding
+ * @details Parameters linked by a topology precondition are bound by a join
+ *          over the adjacency index instead of over every pair of assets, so
+ *          a two parameter exploit costs as many bindings as there are links.
+ *          Each step picks the precondition that filters bindings (both
+ *          parameters bound), then one that extends them (one parameter
+ *          bound), then the one with the fewest links. Parameters no usable
+ *          precondition constrains range over every asset.
+ *
+ *          Preconditions on properties that a postcondition can add links for
+ *          are left out of the join and checked per state as before. The
+ *          bindings come out in the order the Odometer lists them.
+ *
+ * @return Global asset IDs of every binding, one vector per binding
+ */
+static PermSet<size_t> bind_exploit(const Exploit &ex, const AGGenInstance &instance,
+                                    const AdjacencyIndex &adjacency) {
+    size_t num_params = ex.get_num_params();
+    const size_t unbound = std::numeric_limits<size_t>::max();
+
+    std::vector<std::pair<const ParameterizedTopology *, const Links *>> joins;
+    for (const auto &precond : ex.precond_list_t()) {
+        int property = instance.facts[precond.get_property()];
+        if (adjacency.added.count(property))
+            continue;
+        auto it = adjacency.links.find(std::make_pair(property, precond.get_dir()));
+        static const Links none;
+        joins.emplace_back(&precond, it == adjacency.links.end() ? &none : &it->second);
     }
 
-    for (auto &postcond : param_postconds_t) {
-        auto action = std::get<0>(postcond);
-        auto fact = std::get<1>(postcond);
+    PermSet<size_t> perms(1, std::vector<size_t>(num_params, unbound));
+    std::vector<bool> bound(num_params, false);
+    while (!joins.empty()) {
+        auto rank = [&](const std::pair<const ParameterizedTopology *, const Links *> &join) {
+            size_t bound_params = bound[join.first->get_from_param()] + bound[join.first->get_to_param()];
+            return std::make_pair(2 - bound_params, join.second->by_from.size());
+        };
+        auto next = std::min_element(joins.begin(), joins.end(),
+                                     [&](const auto &a, const auto &b) { return rank(a) < rank(b); });
+        size_t from = next->first->get_from_param();
+        size_t to = next->first->get_to_param();
+        const Links &links = *next->second;
+        joins.erase(next);
 
-        auto dir = fact.get_dir();
-        auto prop = fact.get_property();
-        auto op = fact.get_operation();
-        auto val = fact.get_value();
+        PermSet<size_t> joined;
+        for (auto &perm : perms) {
+            if (bound[from] && bound[to]) {
+                if (std::binary_search(links.by_from.begin(), links.by_from.end(),
+                                       std::make_pair(perm[from], perm[to])))
+                    joined.push_back(std::move(perm));
+                continue;
+            }
+            // Extend from the bound end of the link, or from every link
+            bool reverse = bound[to];
+            const auto &pairs = reverse ? links.by_to : links.by_from;
+            auto first = pairs.begin();
+            auto last = pairs.end();
+            if (bound[from] || bound[to]) {
+                size_t asset = reverse ? perm[to] : perm[from];
+                first = std::lower_bound(pairs.begin(), pairs.end(), std::make_pair(asset, size_t{0}));
+                last = std::lower_bound(first, pairs.end(), std::make_pair(asset, unbound));
+            }
+            for (; first != last; ++first) {
+                // A precondition from a parameter to itself needs a self link
+                if (from == to && first->first != first->second)
+                    continue;
+                auto ext = perm;
+                ext[reverse ? to : from] = first->first;
+                ext[reverse ? from : to] = first->second;
+                joined.push_back(std::move(ext));
+            }
+        }
+        perms = std::move(joined);
+        bound[from] = bound[to] = true;
+    }
 
-        Topology t(perm[fact.get_from_param()],
-                   perm[fact.get_to_param()], dir, prop, op, val, facts);
-        postconds_t.emplace_back(action, t);
+    for (size_t param = 0; param < num_params; param++) {
+        if (bound[param])
+            continue;
+        PermSet<size_t> joined;
+        joined.reserve(perms.size() * instance.asset_ids.size());
+        for (auto &perm : perms) {
+            for (auto asset : instance.asset_ids) {
+                joined.push_back(perm);
+                joined.back()[param] = asset;
+            }
+        }
+        perms = std::move(joined);
     }
 
-    return make_tuple(postconds_q, postconds_t);
+    // The Odometer turns the first parameter fastest
+    std::sort(perms.begin(), perms.end(), [](const std::vector<size_t> &a, const std::vector<size_t> &b) {
+        return std::lexicographical_compare(a.rbegin(), a.rend(), b.rbegin(), b.rend());
+    });
+    perms.erase(std::unique(perms.begin(), perms.end()), perms.end());
+    return perms;
 }
 
 /**
- * @brief Generate attack graph
- * @details Begin the generation of the attack graph. The algorithm is as
- * follows:
+ * @brief Grounds an exploit to each of its bindings
+ * @details The Keyvalue IDs of the exploit's parameterized facts are looked
+ *          up, and its comparisons compiled, once. Each permutation then only
+ *          fills in asset IDs to get the encoded preconditions and
+ *          postconditions of its AssetGroup.
  *
- *      1. Fetch next factbase to expand from the frontier
- *      2. Fetch all exploits
- *      3. Loop over each exploit to determine if it is applicable.
- *          a. Fetch preconditions of the exploit
- *          b. Generate all permutations of assets using the Odometer utility
- *          c. Apply each permutation of the assets to the preconditions.
- *          d. Check if ALL generated preconditions are present in the current
- * factbase. 4a. If all preconditions are found, apply the matching asset group
- * to the postconditions of the exploit. 4b. If not all preconditions are found,
- * break and continue checking with the next exploit.
- *      5. Push the new network state onto the frontier to be expanded later.
+ * @param ex The exploit to ground
+ * @param perms The bindings of the exploit's parameters, from bind_exploit()
+ * @return One AssetGroup per binding
  */
-AGGenInstance &AGGen::generate(bool batch_process, int batch_size, int numThrd, int initQSize) {
+static std::vector<AssetGroup> ground_exploit(const Exploit &ex, const PermSet<size_t> &perms,
+                                              const Keyvalue &facts, const FactLayout &layout,
+                                              const ValueIndex &index) {
+    using Values = std::shared_ptr<const std::vector<int>>;
+    struct QualityIds {
+        ACTION_T action;
+        int param, attr, val;
+        Values values; //!< Set for a comparison other than equality
+    };
+    struct TopologyIds {
+        ACTION_T action;
+        int from_param, to_param;
+        DIRECTION_T dir;
+        int property, value;
+        Values values;
+    };
 
-    std::vector<Exploit> exploit_list = instance.exploits;
-    auto counter = 0;
-    auto start = std::chrono::system_clock::now();
+    auto quality_ids = [&](ACTION_T action, const ParameterizedQuality &q) {
+        OPERATION_T op = parse_operation(q.op);
+        if (op != EQ_T)
+            return QualityIds{action, q.get_param_num(), facts[q.name], 0,
+                              compile_comparison(index, facts[q.name], op, q.value, facts)};
+        return QualityIds{action, q.get_param_num(), facts[q.name], facts[q.value], nullptr};
+    };
+    auto topology_ids = [&](ACTION_T action, const ParameterizedTopology &t, const std::string &op_str) {
+        OPERATION_T op = parse_operation(op_str);
+        int property = facts[t.get_property()];
+        if (op != EQ_T)
+            return TopologyIds{action, t.get_from_param(), t.get_to_param(), t.get_dir(), property, 0,
+                               compile_comparison(index, property, op, t.get_value(), facts)};
+        return TopologyIds{action, t.get_from_param(), t.get_to_param(), t.get_dir(),
+                           property, facts[t.get_value()], nullptr};
+    };
 
-    unsigned long esize = exploit_list.size();
-    printf("esize is %ld\n",esize);
+    std::vector<QualityIds> pre_q, post_q;
+    std::vector<TopologyIds> pre_t, post_t;
+    for (const auto &precond : ex.precond_list_q())
+        pre_q.push_back(quality_ids(ADD_T, precond));
+    for (const auto &precond : ex.precond_list_t())
+        pre_t.push_back(topology_ids(ADD_T, precond, precond.get_operation()));
+    // Postconditions assign values, so their operator is not a comparison
+    for (const auto &postcond : ex.postcond_list_q()) {
+        ParameterizedQuality fact = std::get<1>(postcond);
+        fact.op.clear();
+        post_q.push_back(quality_ids(std::get<0>(postcond), fact));
+    }
+    for (const auto &postcond : ex.postcond_list_t())
+        post_t.push_back(topology_ids(std::get<0>(postcond), std::get<1>(postcond), ""));
 
-    bool save_queued = false;
+    std::vector<AssetGroup> asset_groups;
+    asset_groups.reserve(perms.size());
+    std::vector<Fact> encoded;
+    for (const auto &perm : perms) {
+        std::vector<GroundedCondition> preconds;
+        std::vector<GroundedFact> post_quals;
+        std::vector<GroundedFact> post_topos;
 
-    std::cout << "Generating Attack Graph" << std::endl;
+        for (const auto &q : pre_q)
+            preconds.push_back({layout.quality(perm[q.param], q.attr, q.val), false, q.values});
+        for (const auto &t : pre_t) {
+            encoded.clear();
+            Topology::encode_facts(layout, perm[t.from_param], perm[t.to_param], t.dir,
+                                   t.property, t.values ? 0 : t.value, encoded);
+            // A bidirectional link to the same asset is one fact, but it
+            // keeps both positions so every group lists the same preconditions
+            if (t.dir == BIDIRECTION_T && encoded.size() == 1)
+                encoded.push_back(encoded.front());
+            for (auto fact : encoded)
+                preconds.push_back({fact, true, t.values});
+        }
+        for (const auto &q : post_q)
+            post_quals.push_back({q.action, layout.quality(perm[q.param], q.attr, q.val)});
+        for (const auto &t : post_t) {
+            encoded.clear();
+            Topology::encode_facts(layout, perm[t.from_param], perm[t.to_param], t.dir,
+                                   t.property, t.value, encoded);
+            for (auto fact : encoded)
+                post_topos.push_back({t.action, fact});
+        }
 
-    std::unordered_map<size_t, PermSet<size_t>> od_map;
-    size_t assets_size = instance.assets.size();
-    for (const auto &ex : exploit_list) {
-        size_t num_params = ex.get_num_params();
-        if (od_map.find(num_params) == od_map.end()) {
-            Odometer<size_t> od(num_params, assets_size);
-            od_map[num_params] = od.get_all();
+        asset_groups.emplace_back(std::move(preconds), std::move(post_quals),
+                                  std::move(post_topos), perm);
+    }
+    return asset_groups;
+}
+
+/**
+ * @brief Checks a single grounded precondition against a factbase
+ */
+static inline bool condition_holds(const Factbase &factbase, const GroundedCondition &cond) {
+    if (cond.topology) {
+        return cond.values ? factbase.find_topology_value(cond.fact, *cond.values)
+                           : factbase.find_topology(cond.fact);
+    }
+    return cond.values ? factbase.find_quality_value(cond.fact, *cond.values)
+                       : factbase.find_quality(cond.fact);
+}
+
+/**
+ * @brief Finds the applicable asset groups in a range of the flat group list
+ * @details Asset groups are numbered exploit after exploit, group_start[i]
+ *          being the number of the first group of exploit i, so a state's
+ *          matching can be split into ranges. Preconditions are checked most
+ *          selective first and every check is counted in stats.
+ *
+ * @param first The first group of the range
+ * @param last One past the last group of the range
+ * @param matched Receives the (exploit index, asset group index) pairs that
+ *                apply, in group order
+ */
+static void match_groups(const Factbase &factbase,
+                         const std::vector<std::vector<AssetGroup>> &exploit_groups,
+                         const std::vector<size_t> &group_start, size_t first, size_t last,
+                         Selectivity &stats, std::vector<std::pair<size_t, size_t>> &matched) {
+    uint64_t checks = 0;
+    size_t i = std::upper_bound(group_start.begin(), group_start.end(), first) - group_start.begin() - 1;
+    for (; first < last; i++) {
+        const auto &order = stats.get_order(i);
+        Selectivity::Counter *counters = stats.get_counters(i);
+        size_t end = std::min(last, group_start[i + 1]);
+        for (size_t j = first - group_start[i]; j < end - group_start[i]; j++) {
+            const auto &preconds = exploit_groups[i][j].get_preconditions();
+            for (uint32_t k : order) {
+                checks++;
+                counters[k].tested++;
+                if (!condition_holds(factbase, preconds[k])) {
+                    goto LOOPCONTINUE;
+                }
+                counters[k].passed++;
+            }
+            matched.emplace_back(i, j);
+        LOOPCONTINUE:;
         }
+        first = end;
     }
-//might be where to apply parallelization.
-    while (!frontier.empty()) {//while loop starts
-        auto current_state = frontier.back();
-        auto current_hash = current_state.get_hash(instance.facts);
+    stats.tick(checks);
+}
+
+// Parallel matching: whole states are matched in parallel while the frontier
+// holds at least this many states per worker, otherwise the next state's
+// groups are split into chunks of at least MIN_CHUNK groups
+static constexpr size_t STATES_PER_WORKER = 4;
+static constexpr size_t CHUNKS_PER_WORKER = 4;
+static constexpr size_t MIN_CHUNK = 256;
+
+/**
+ * @param states The number of states generated so far
+ * @param edges The number of edges generated so far
+ * @return Whether generation has to stop
+ */
+bool Budget::exceeded(size_t states, size_t edges) {
+    if (reason.load(std::memory_order_relaxed))
+        return true;
+    const char *hit = nullptr;
+    if (limits.max_states && states >= limits.max_states) {
+        hit = "max-states";
+    } else if (limits.max_edges && edges >= limits.max_edges) {
+        hit = "max-edges";
+    } else if (limits.max_seconds > 0 &&
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >=
+                   limits.max_seconds) {
+        hit = "max-seconds";
+    } else if (limits.max_rss && checks.fetch_add(1, std::memory_order_relaxed) % RSS_INTERVAL == 0 &&
+               resident_memory() >= limits.max_rss) {
+        hit = "max-rss";
+    }
+    if (!hit)
+        return false;
+    const char *none = nullptr;
+    reason.compare_exchange_strong(none, hit);
+    return true;
+}
+
+/**
+ * @brief Applies the postconditions of an asset group to a copy of a state
+ */
+static void apply_postconditions(const AssetGroup &assetGroup, NetworkState &new_state) {
+    for (const auto &qual : assetGroup.get_postcond_quals()) {
+        switch (qual.action) {
+        case ADD_T:
+            new_state.add_quality(qual.fact);
+            break;
+        case UPDATE_T:
+            new_state.update_quality(qual.fact);
+            break;
+        case DELETE_T:
+            new_state.delete_quality(qual.fact);
+            break;
+        }
+    }
+    for (const auto &topo : assetGroup.get_postcond_topos()) {
+        switch (topo.action) {
+        case ADD_T:
+            new_state.add_topology(topo.fact);
+            break;
+        case UPDATE_T:
+            new_state.update_topology(topo.fact);
+            break;
+        case DELETE_T:
+            new_state.delete_topology(topo.fact);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Finds the applicable asset groups a state's path leaves room for
+ * @details Like match_groups(), except that a state at the depth bound
+ *          matches nothing, and that the groups of exploits that fired as
+ *          often as allowed on the path to the state are dropped.
+ */
+static void match_bounded(const NetworkState &state, const PathLimits &paths, const Grounding &grounding,
+                          size_t first, size_t last, Selectivity &stats,
+                          std::vector<std::pair<size_t, size_t>> &matched) {
+    if (paths.max_depth > 0 && state.get_depth() >= paths.max_depth)
+        return;
+    size_t begin = matched.size();
+    match_groups(state.get_factbase(), grounding.exploit_groups, grounding.group_start, first, last, stats,
+                 matched);
+    if (!paths.counts_fired())
+        return;
+    auto exhausted = [&](const std::pair<size_t, size_t> &appl) {
+        return state.get_fired(appl.first) >= paths.max_fired[appl.first];
+    };
+    matched.erase(std::remove_if(matched.begin() + begin, matched.end(), exhausted), matched.end());
+}
+
+/**
+ * @brief Builds a successor: applies a group's postconditions and extends the path
+ */
+static inline void apply_step(const Grounding &grounding, const PathLimits &paths, size_t exploit,
+                              size_t group, NetworkState &new_state) {
+    apply_postconditions(grounding.exploit_groups[exploit][group], new_state);
+    new_state.extend_path(exploit, paths.counts_fired() ? paths.max_fired.size() : 0);
+}
+
+/**
+ * @brief Grounds every exploit, unless that was done already
+ * @details The grounded preconditions and postconditions only depend on the
+ *          exploit and the binding, so they are built once rather than for
+ *          every state. Every binding also goes into the edge binding pool up
+ *          front, so that workers can share the offsets.
+ */
+void AGGen::ground() {
+    if (!grounding.group_start.empty())
+        return;
+
+    const auto &exploit_list = instance.exploits;
+    size_t esize = exploit_list.size();
+    ValueIndex value_index = index_values(instance);
+    AdjacencyIndex adjacency = index_adjacency(instance);
+    auto &exploit_groups = grounding.exploit_groups;
+    exploit_groups.reserve(esize);
+    for (const auto &ex : exploit_list) {
+        exploit_groups.push_back(ground_exploit(ex, bind_exploit(ex, instance, adjacency),
+                                                instance.facts, instance.layout, value_index));
+    }
+
+    auto &binding_offsets = grounding.binding_offsets;
+    binding_offsets.resize(esize);
+    for (size_t i = 0; i < esize; i++) {
+        binding_offsets[i].reserve(exploit_groups[i].size());
+        for (const auto &group : exploit_groups[i])
+            binding_offsets[i].push_back(instance.edges.add_binding(group.get_perm()));
+    }
+
+    // Start of each exploit's groups in a flat numbering of all asset groups
+    auto &group_start = grounding.group_start;
+    group_start.assign(esize + 1, 0);
+    for (size_t i = 0; i < esize; i++)
+        group_start[i + 1] = group_start[i] + exploit_groups[i].size();
+    grounding.total_groups = group_start[esize];
+}
+
+/**
+ * @brief Finds the successors of a single state on the calling thread
+ * @details For callers that drive the search themselves, such as the workers
+ *          of a partitioned run. Successors equal to the state are skipped.
+ *          Each successor lives in the calling thread's Arena until the next
+ *          call, so emit has to copy the ones it keeps.
+ *
+ * @param state The state to expand
+ * @param emit Called for every successor, in group order
+ */
+void AGGen::expand(const NetworkState &state, const Successor &emit) {
+    ground();
+    Arena &arena = Arena::local();
+    arena.release();
+    applicable.clear();
+    match_bounded(state, paths, grounding, 0, grounding.total_groups, selectivity, applicable);
+
+    auto hash = state.get_hash();
+    for (const auto &appl : applicable) {
+        NetworkState new_state{state, arena.get()};
+        apply_step(grounding, paths, appl.first, appl.second, new_state);
+        if (new_state.get_hash() != hash)
+            emit(appl.first, appl.second, new_state);
+    }
+}
+
+/**
+ * @brief Grounds the exploits and gives a thread its own matcher state
+ * @details match() and apply() only read the generator, so any number of
+ *          threads can call them at once, each with the scratch space this
+ *          returned to it.
+ */
+MatchScratch AGGen::make_scratch() {
+    ground();
+    return MatchScratch{selectivity, {}};
+}
+
+/**
+ * @brief Finds the asset groups whose preconditions hold in a state
+ * @details The matches replace scratch.applicable, in group order, without
+ *          applying any of them.
+ */
+void AGGen::match(const NetworkState &state, MatchScratch &scratch) const {
+    scratch.applicable.clear();
+    match_groups(state.get_factbase(), grounding.exploit_groups, grounding.group_start, 0,
+                 grounding.total_groups, scratch.stats, scratch.applicable);
+}
+
+/**
+ * @brief Applies the postconditions of a matched asset group to a state
+ */
+void AGGen::apply(size_t exploit, size_t group, NetworkState &state) const {
+    apply_postconditions(grounding.exploit_groups[exploit][group], state);
+}
+
+/**
+ * @brief State of one work-stealing worker
+ * @details Generated states and edges are kept per worker and joined once
+ *          every worker is done, so workers only share the visited table.
+ */
+struct StealingWorker {
+    WorkDeque<NetworkState *> deque;
+    std::vector<Factbase> factbases;
+    std::vector<FactbaseItems> factbase_items;
+    EdgeList edges; //!< Binding offsets point into the instance's pool
+    std::vector<std::pair<size_t, size_t>> matched;
+    uint64_t seed; //!< Picks the first victim to steal from
+};
+
+/**
+ * @brief Expands the frontier and everything reachable from it on all workers
+ * @details Each worker owns a Chase-Lev deque. It pushes the successors it
+ *          finds onto its own deque and takes its next state from it, the
+ *          newest one for DEPTH_FIRST_T and the oldest for BREADTH_FIRST_T.
+ *          An idle worker steals the oldest state of another worker, starting
+ *          at a random victim. The visited table is shared by all workers and
+ *          is lock free apart from growing. pending counts the states that are queued or
+ *          being expanded; a successor is counted before its parent is
+ *          released, so pending only reaches zero once no work is left
+ *          anywhere, and every worker then stops.
+ *
+ *          State and Edge IDs come from the global atomic counters, so they
+ *          depend on the timing of the workers.
+ *
+ *          Workers check the budget before taking a state. Once it is
+ *          exceeded they all stop, and the states still queued go back on
+ *          the frontier.
+ */
+static void expand_stealing(AGGenInstance &instance, std::deque<NetworkState> &frontier,
+                            VisitedTable &visited, const Grounding &grounding,
+                            std::vector<Selectivity> &worker_stats, ThreadPool &pool,
+                            SEARCH_ORDER_T order, const PathLimits &paths, Budget &budget) {
+    size_t num_workers = pool.size();
+    std::vector<std::unique_ptr<StealingWorker>> workers;
+    for (size_t w = 0; w < num_workers; w++) {
+        workers.emplace_back(new StealingWorker);
+        workers[w]->seed = 0x9e3779b97f4a7c15ULL * (w + 1);
+    }
+
+    std::atomic<size_t> pending{frontier.size()};
+    std::atomic<size_t> num_states{instance.factbases.size()};
+    std::atomic<size_t> num_edges{instance.edges.size()};
+    for (size_t s = 0; !frontier.empty(); s++) {
+        workers[s % num_workers]->deque.push(new NetworkState(std::move(frontier.back())));
         frontier.pop_back();
-        std::vector<std::tuple<Exploit, AssetGroup>> appl_exploits;
-        for (size_t i = 0; i < esize; i++) {//for loop for applicable exploits starts
-            auto e = exploit_list.at(i);
-            size_t num_params = e.get_num_params();
-            auto preconds_q = e.precond_list_q();
-            auto preconds_t = e.precond_list_t();
-            auto perms = od_map[num_params];
-            std::vector<AssetGroup> asset_groups;
-            for (auto perm : perms) {
-                std::vector<Quality> asset_group_quals;
-                std::vector<Topology> asset_group_topos;
-                asset_group_quals.reserve(preconds_q.size());
-                asset_group_topos.reserve(preconds_t.size());
-                for (auto &precond : preconds_q) {
-                    asset_group_quals.emplace_back(
-                        perm[precond.get_param_num()], precond.name, "=",
-                        precond.value, instance.facts);
+    }
+
+    pool.run(num_workers, [&](size_t w, size_t) {
+        StealingWorker &self = *workers[w];
+        Arena &arena = Arena::local();
+        while (!budget.exceeded(num_states.load(std::memory_order_relaxed),
+                                num_edges.load(std::memory_order_relaxed))) {
+            NetworkState *state = order == DEPTH_FIRST_T ? self.deque.take() : self.deque.steal();
+            if (!state) {
+                self.seed ^= self.seed << 13;
+                self.seed ^= self.seed >> 7;
+                self.seed ^= self.seed << 17;
+                for (size_t k = 0; k < num_workers && !state; k++) {
+                    size_t victim = (self.seed + k) % num_workers;
+                    if (victim != w)
+                        state = workers[victim]->deque.steal();
                 }
-                for (auto &precond : preconds_t) {
-                    auto dir = precond.get_dir();
-                    auto prop = precond.get_property();
-                    auto op = precond.get_operation();
-                    auto val = precond.get_value();
-
-                    asset_group_topos.emplace_back(
-                        perm[precond.get_from_param()],
-                        perm[precond.get_to_param()], dir, prop, op, val, instance.facts);
+            }
+            if (!state) {
+                if (pending.load(std::memory_order_acquire) == 0)
+                    break;
+                std::this_thread::yield();
+                continue;
+            }
+
+            arena.release();
+            self.matched.clear();
+            match_bounded(*state, paths, grounding, 0, grounding.total_groups, worker_stats[w], self.matched);
+            auto current_hash = state->get_hash();
+            size_t states_before = self.factbases.size();
+            size_t edges_before = self.edges.size();
+
+            for (const auto &appl : self.matched) {
+                NetworkState new_state{*state, arena.get()};
+                apply_step(grounding, paths, appl.first, appl.second, new_state);
+                auto hash_num = new_state.get_hash();
+                if (hash_num == current_hash)
+                    continue;
+
+                auto entry = visited.insert_or_get(hash_num, [&] {
+                    new_state.set_id();
+                    return new_state.get_id();
+                });
+                int id = entry.first;
+                bool is_new = entry.second;
+                if (is_new) {
+                    self.factbase_items.emplace_back(new_state.get_factbase().get_facts_tuple(), id);
+                    self.factbases.push_back(new_state.get_factbase());
+                    pending.fetch_add(1, std::memory_order_relaxed);
+                    self.deque.push(new NetworkState(new_state));
                 }
+                self.edges.add_unique(state->get_id(), id, appl.first,
+                                      grounding.binding_offsets[appl.first][appl.second]);
+            }
+            num_states.fetch_add(self.factbases.size() - states_before, std::memory_order_relaxed);
+            num_edges.fetch_add(self.edges.size() - edges_before, std::memory_order_relaxed);
+            delete state;
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        arena.release();
+    });
 
-                asset_groups.emplace_back(asset_group_quals, asset_group_topos,
-                                          perm);
+    // Only left over when the budget ran out
+    for (auto &worker : workers) {
+        while (NetworkState *state = worker->deque.take()) {
+            frontier.push_back(std::move(*state));
+            delete state;
+        }
+    }
+
+    for (auto &worker : workers) {
+        std::move(worker->factbases.begin(), worker->factbases.end(),
+                  std::back_inserter(instance.factbases));
+        std::move(worker->factbase_items.begin(), worker->factbase_items.end(),
+                  std::back_inserter(instance.factbase_items));
+        instance.edges.append_edges(worker->edges);
+    }
+}
+
+/**
+ * @brief Expands the frontier level by level, with IDs that do not depend on
+ *        timing or on the number of workers
+ * @details All states of a level are expanded in parallel, each state's
+ *          asset groups split into chunks when the level is too small to
+ *          keep every worker busy. Workers only read the visited table. A
+ *          successor it does not hold is also looked up in a table of the
+ *          hashes seen in this level, and only the worker that adds it there
+ *          keeps a copy, so a child of many parents is copied once. Once the
+ *          level is done, the new successors are sorted by hash and numbered
+ *          in that order. Edges are then added in the order of their source
+ *          state in the level and of their asset group. The next level is the
+ *          new states in hash order, so every level, and therefore every
+ *          state and edge ID, only depends on the model.
+ *
+ *          Every task checks the budget before it starts. Once it is exceeded
+ *          the remaining tasks are skipped, the successors found so far are
+ *          still added, and the states that were not fully expanded go back
+ *          on the frontier together with the new states. Where a run stops
+ *          then depends on timing.
+ */
+static void expand_levels(AGGenInstance &instance, std::deque<NetworkState> &frontier,
+                          VisitedTable &visited, const Grounding &grounding,
+                          std::vector<Selectivity> &worker_stats, ThreadPool &pool,
+                          const PathLimits &paths, Budget &budget) {
+    struct Successor {
+        size_t exploit;
+        size_t group;
+        size_t hash;
+        NetworkState *state; //!< Copy of a state new to this level, for one of its parents, else null
+    };
+    size_t num_workers = pool.size();
+    size_t total_groups = grounding.total_groups;
+
+    std::vector<NetworkState> level;
+    while (!frontier.empty()) {
+        level.push_back(std::move(frontier.back()));
+        frontier.pop_back();
+    }
+
+    std::vector<std::vector<Successor>> found;
+    std::vector<std::vector<std::pair<size_t, size_t>>> matched(num_workers);
+    while (!level.empty()) {
+        VisitedTable seen(level.size());
+        size_t chunks = 1;
+        if (num_workers > 1 && level.size() < 2 * num_workers && total_groups >= 2 * MIN_CHUNK)
+            chunks = std::min(num_workers * CHUNKS_PER_WORKER, total_groups / MIN_CHUNK);
+
+        size_t tasks = level.size() * chunks;
+        if (found.size() < tasks)
+            found.resize(tasks);
+        std::vector<char> skipped(tasks, 0);
+        size_t base_states = instance.factbases.size();
+        size_t base_edges = instance.edges.size();
+        std::atomic<size_t> level_states{0};
+        std::atomic<size_t> level_edges{0};
+        pool.run(tasks, [&](size_t task, size_t worker) {
+            found[task].clear();
+            if (budget.exceeded(base_states + level_states.load(std::memory_order_relaxed),
+                                base_edges + level_edges.load(std::memory_order_relaxed))) {
+                skipped[task] = 1;
+                return;
             }
-            auto assetgroup_size = asset_groups.size();
-            for (size_t j = 0; j < assetgroup_size; j++) {
-                auto asset_group = asset_groups.at(j);
-                for (auto &quality : asset_group.get_hypo_quals()) {
-                    if (!current_state.get_factbase().find_quality(quality)) {
-                        goto LOOPCONTINUE;
-                    }
-                }
-                for (auto &topology : asset_group.get_hypo_topos()) {
-                    if (!current_state.get_factbase().find_topology(topology)) {
-                        goto LOOPCONTINUE;
-                    }
-                }
-                {
-                    auto new_appl_exploit = std::make_tuple(e, asset_group);
-                    appl_exploits.push_back(new_appl_exploit);
+            const NetworkState &state = level[task / chunks];
+            size_t chunk = task % chunks;
+            auto &appl_exploits = matched[worker];
+            appl_exploits.clear();
+            match_bounded(state, paths, grounding, total_groups * chunk / chunks,
+                          total_groups * (chunk + 1) / chunks, worker_stats[worker], appl_exploits);
+
+            Arena &arena = Arena::local();
+            auto current_hash = state.get_hash();
+            for (const auto &appl : appl_exploits) {
+                arena.release();
+                NetworkState new_state{state, arena.get()};
+                apply_step(grounding, paths, appl.first, appl.second, new_state);
+                auto hash_num = new_state.get_hash();
+                if (hash_num == current_hash)
+                    continue;
+                NetworkState *copy = nullptr;
+                if (visited.find(hash_num) < 0 && seen.insert_or_get(hash_num, [] { return 0; }).second) {
+                    copy = new NetworkState(new_state);
+                    level_states.fetch_add(1, std::memory_order_relaxed);
                 }
-            LOOPCONTINUE:;
+                found[task].push_back({appl.first, appl.second, hash_num, copy});
             }
-        } //for loop for applicable exploits ends
-
-        auto appl_expl_size = appl_exploits.size();
-        int nth=1;
-        if(appl_expl_size<2) nth=1;
-	else if(appl_expl_size<33) nth=appl_expl_size;
-	else nth=32;
-        for (size_t j = 0; j < appl_expl_size; j++) { //for loop for new states starts
-            auto e = appl_exploits.at(j);
-            auto exploit = std::get<0>(e);
-            auto assetGroup = std::get<1>(e);
-            auto postconditions = createPostConditions(e, instance.facts);
-            auto qualities = std::get<0>(postconditions);
-            auto topologies = std::get<1>(postconditions);
-            NetworkState new_state{current_state};
-            for(auto &qual : qualities) {
-                auto action = std::get<0>(qual);
-                auto fact = std::get<1>(qual);
-                switch(action) {
-                case ADD_T:
-                    new_state.add_quality(fact);
-                    break;
-                case UPDATE_T:
-                    new_state.update_quality(fact);
-                    break;
-                case DELETE_T:
-                    new_state.delete_quality(fact);
-                    break;
-                }
+            level_edges.fetch_add(found[task].size(), std::memory_order_relaxed);
+            arena.release();
+        });
+
+        // Number the new states in hash order
+        std::vector<std::pair<size_t, NetworkState *>> fresh;
+        for (size_t t = 0; t < tasks; t++) {
+            for (const auto &succ : found[t]) {
+                if (succ.state)
+                    fresh.emplace_back(succ.hash, succ.state);
             }
-            for(auto &topo : topologies) {
-                auto action = std::get<0>(topo);
-                auto fact = std::get<1>(topo);
-                switch(action) {
-                case ADD_T:
-                    new_state.add_topology(fact);
-                    break;
-                case UPDATE_T:
-                    new_state.update_topology(fact);
-                    break;
-                case DELETE_T:
-                    new_state.delete_topology(fact);
-                    break;
+        }
+        std::stable_sort(fresh.begin(), fresh.end(),
+                         [](const std::pair<size_t, NetworkState *> &a,
+                            const std::pair<size_t, NetworkState *> &b) { return a.first < b.first; });
+
+        std::vector<NetworkState> next;
+        next.reserve(fresh.size());
+        for (size_t i = 0; i < fresh.size(); i++) {
+            std::unique_ptr<NetworkState> state(fresh[i].second);
+            visited.insert_or_get(fresh[i].first, [&] {
+                state->set_id();
+                return state->get_id();
+            });
+            instance.factbase_items.emplace_back(state->get_factbase().get_facts_tuple(), state->get_id());
+            instance.factbases.push_back(state->get_factbase());
+            next.push_back(std::move(*state));
+        }
+
+        for (size_t t = 0; t < tasks; t++) {
+            int from = level[t / chunks].get_id();
+            for (const auto &succ : found[t]) {
+                instance.edges.add_unique(from, visited.find(succ.hash), succ.exploit,
+                                          grounding.binding_offsets[succ.exploit][succ.group]);
+            }
+        }
+
+        if (budget.stopped()) {
+            for (size_t i = 0; i < level.size(); i++) {
+                if (std::any_of(skipped.begin() + i * chunks, skipped.begin() + (i + 1) * chunks,
+                                [](char skip) { return skip != 0; }))
+                    frontier.push_back(std::move(level[i]));
+            }
+            std::move(next.begin(), next.end(), std::back_inserter(frontier));
+            return;
+        }
+        level = std::move(next);
+    }
+}
+
+#ifdef REDIS
+
+// States taken from the shared work list for each round trip
+static constexpr size_t REDIS_BATCH = 256;
+// How long to wait when the work list is empty but other processes are still
+// expanding states
+static constexpr auto REDIS_WAIT = std::chrono::milliseconds(10);
+
+/**
+ * @brief Appends a state, with its ID and path, to a work list entry
+ */
+static void encode_state(const NetworkState &state, std::string &entry) {
+    auto put = [&](const void *p, size_t length) { entry.append(static_cast<const char *>(p), length); };
+    int32_t id = state.get_id();
+    uint32_t depth = state.get_depth();
+    put(&id, sizeof(id));
+    put(&depth, sizeof(depth));
+    uint32_t counted = static_cast<uint32_t>(state.counted_exploits());
+    put(&counted, sizeof(counted));
+    for (uint32_t e = 0; e < counted; e++) {
+        uint16_t fired = static_cast<uint16_t>(state.get_fired(e));
+        put(&fired, sizeof(fired));
+    }
+    auto facts = state.get_factbase().get_facts_tuple();
+    for (const auto *list : {&std::get<0>(facts), &std::get<1>(facts)}) {
+        uint32_t size = static_cast<uint32_t>(list->size());
+        put(&size, sizeof(size));
+        put(list->data(), list->size() * sizeof(Fact));
+    }
+}
+
+/**
+ * @brief Reads a state back from a work list entry
+ */
+static NetworkState decode_state(const std::string &entry, const FactLayout &layout) {
+    size_t pos = 0;
+    auto get = [&](void *p, size_t length) {
+        if (entry.size() - pos < length)
+            throw std::runtime_error("Truncated state in the Redis work list");
+        std::memcpy(p, entry.data() + pos, length);
+        pos += length;
+    };
+    int32_t id;
+    uint32_t depth;
+    uint32_t counted;
+    get(&id, sizeof(id));
+    get(&depth, sizeof(depth));
+    get(&counted, sizeof(counted));
+    std::vector<uint16_t> fired(counted);
+    get(fired.data(), counted * sizeof(uint16_t));
+    std::vector<Fact> lists[2];
+    for (auto &list : lists) {
+        uint32_t size;
+        get(&size, sizeof(size));
+        list.resize(size);
+        get(list.data(), size * sizeof(Fact));
+    }
+    NetworkState state(std::move(lists[0]), std::move(lists[1]), layout);
+    state.set_id(id);
+    state.set_path(depth, fired);
+    return state;
+}
+
+/**
+ * @brief Expands states shared through Redis until the run is over
+ * @details Every process sharing the visited set runs this loop. It takes up
+ *          to REDIS_BATCH claimed states from the shared work list, matches
+ *          them in parallel and looks their successors up in the shared set
+ *          all at once, in a single round trip (see RedisManager).
+ *          Successors that appear more than once in a batch are only looked
+ *          up once. This process stores the successors it claims and hands
+ *          them in with its next request for work, so any process may expand
+ *          them. It stores the edges out of the states it expands.
+ *
+ *          The budget is checked before every batch, against the states
+ *          and edges this process stored. The first process to exceed its
+ *          budget stops the run for all of them, and each one lists the
+ *          states it claimed that were left in the work list as unexpanded.
+ *          Edge IDs are reserved from a shared counter at the end, so the
+ *          processes can store their graphs in the same database.
+ *
+ *          A process that dies while it holds states leaves the others
+ *          waiting for them.
+ */
+static void expand_redis(AGGenInstance &instance, std::deque<NetworkState> &frontier,
+                         RedisManager &rman, const Grounding &grounding,
+                         std::vector<Selectivity> &worker_stats, ThreadPool &pool,
+                         const PathLimits &paths, Budget &budget) {
+    struct Successor {
+        size_t exploit;
+        size_t group;
+        std::pair<size_t, size_t> key; //!< The two hashes the visited set uses
+        std::unique_ptr<NetworkState> state;
+    };
+
+    // The initial state, if this process claimed it
+    std::vector<std::string> claimed;
+    for (const auto &state : frontier) {
+        claimed.emplace_back();
+        encode_state(state, claimed.back());
+    }
+    frontier.clear();
+
+    std::vector<std::string> taken;
+    std::string reason;
+    std::vector<NetworkState> batch;
+    std::vector<std::vector<Successor>> found;
+    std::vector<std::vector<std::pair<size_t, size_t>>> matched(pool.size());
+    std::map<std::pair<size_t, size_t>, size_t> position;
+    std::vector<std::pair<size_t, size_t>> keys;
+    std::vector<NetworkState *> states;
+    while (true) {
+        std::string limit;
+        if (budget.exceeded(instance.factbases.size(), instance.edges.size()))
+            limit = budget.get_reason();
+        bool over = rman.take_work(claimed, batch.size(), REDIS_BATCH, limit, taken, reason);
+        claimed.clear();
+        batch.clear();
+        if (over)
+            break;
+        if (taken.empty()) {
+            std::this_thread::sleep_for(REDIS_WAIT);
+            continue;
+        }
+        for (const auto &entry : taken)
+            batch.push_back(decode_state(entry, instance.layout));
+
+        if (found.size() < batch.size())
+            found.resize(batch.size());
+        pool.run(batch.size(), [&](size_t task, size_t worker) {
+            const NetworkState &state = batch[task];
+            auto &appl_exploits = matched[worker];
+            appl_exploits.clear();
+            found[task].clear();
+            match_bounded(state, paths, grounding, 0, grounding.total_groups, worker_stats[worker],
+                          appl_exploits);
+
+            Arena &arena = Arena::local();
+            auto current_hash = state.get_hash();
+            for (const auto &appl : appl_exploits) {
+                arena.release();
+                NetworkState new_state{state, arena.get()};
+                apply_step(grounding, paths, appl.first, appl.second, new_state);
+                auto hash_num = new_state.get_hash();
+                if (hash_num == current_hash)
+                    continue;
+                std::pair<size_t, size_t> key{hash_num,
+                                              new_state.get_factbase().hash(RedisManager::CHECK_SEED)};
+                found[task].push_back({appl.first, appl.second, key,
+                                       std::unique_ptr<NetworkState>(new NetworkState(new_state))});
+            }
+            arena.release();
+        });
+
+        position.clear();
+        keys.clear();
+        states.clear();
+        for (size_t t = 0; t < batch.size(); t++) {
+            for (auto &succ : found[t]) {
+                if (position.emplace(succ.key, keys.size()).second) {
+                    keys.push_back(succ.key);
+                    states.push_back(succ.state.get());
                 }
             }
-            auto hash_num = new_state.get_hash(instance.facts);
-            if (hash_num == current_hash)
+        }
+        auto ids = rman.insert_or_get(keys);
+
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!ids[i].second)
                 continue;
-            if (hash_map.find(hash_num) == hash_map.end()) {
+            NetworkState &state = *states[i];
+            state.set_id(ids[i].first);
+            instance.factbase_items.emplace_back(state.get_factbase().get_facts_tuple(), ids[i].first);
+            instance.factbases.push_back(state.get_factbase());
+            claimed.emplace_back();
+            encode_state(state, claimed.back());
+        }
+        for (size_t t = 0; t < batch.size(); t++) {
+            int from = batch[t].get_id();
+            for (const auto &succ : found[t]) {
+                instance.edges.add_unique(from, ids[position[succ.key]].first, succ.exploit,
+                                          grounding.binding_offsets[succ.exploit][succ.group]);
+            }
+        }
+    }
+
+    if (!reason.empty()) {
+        instance.stop_reason = reason;
+        // Nobody takes work once the run has stopped, so what is left waiting is final
+        std::unordered_set<int> own;
+        for (const auto &factbase : instance.factbases) {
+            if (paths.max_depth == 0 || factbase.get_depth() < paths.max_depth)
+                own.insert(factbase.get_id());
+        }
+        for (const auto &entry : rman.waiting()) {
+            int32_t id;
+            std::memcpy(&id, entry.data(), sizeof(id));
+            if (own.count(id))
+                instance.unexpanded.push_back(id);
+        }
+    }
+    instance.edges.renumber(rman.reserve_edge_ids(instance.edges.size()));
+}
+
+#endif
+
+/**
+ * @brief Generate attack graph
+ * @details Begin the generation of the attack graph. The algorithm is as
+ * follows:
+ *
+ *      1. Apply every binding of assets to the preconditions and
+ *         postconditions of every exploit, once, before generation starts.
+ *         Parameters linked by a topology only bind linked assets.
+ *      2. Fetch next factbase to expand from the frontier
+ *      3. Loop over each exploit to determine if it is applicable.
+ *          a. Check if ALL preconditions of a grounded asset group are present
+ * in the current factbase, most selective first (see Selectivity). 4a. If all preconditions are found, apply the
+ * matching asset group to the postconditions of the exploit. 4b. If not all
+ * preconditions are found, continue checking with the next asset group.
+ *      5. Push the new network state onto the frontier to be expanded later.
+ *
+ * With numThrd workers, step 3 runs on a thread pool: for several frontier
+ * states at once when the frontier is large, or split over the asset groups
+ * of a single state when it is not. Steps 4 and 5 stay on the calling thread,
+ * in frontier order. Once the frontier holds initQSize states, and at least
+ * two per worker, the rest of the graph is expanded by work-stealing workers
+ * (see expand_stealing()), whose state and edge IDs depend on timing.
+ *
+ * In deterministic mode the whole graph is expanded level by level instead
+ * (see expand_levels()), and the IDs are the same for any number of workers.
+ * With a Redis visited set, the whole graph is expanded in batches taken from
+ * a work list shared with the other processes of the run, and their
+ * successors are looked up in the shared set (see expand_redis()).
+ *
+ * Generation stops early once any of the limits given to set_limits() is
+ * reached. The states that were found but not expanded are listed in the
+ * unexpanded field of the instance, and stop_reason names the limit.
+ *
+ * Every state records the depth of the path it was first reached by. With
+ * path limits (see set_path_limits()), states at the depth bound are kept and
+ * listed as unexpanded too, and exploits stop firing along a path once they
+ * fired as often as allowed. Paths are only shortest in breadth-first order:
+ * with -D, or before work stealing takes over.
+ *
+ * The generated instance is moved out of the generator, which should not be
+ * used again afterwards.
+ *
+ * batch_process and batch_size, set with -b, are not used here: the thread
+ * pool decides how many states each round expands.
+ */
+AGGenInstance AGGen::generate([[maybe_unused]] bool batch_process, [[maybe_unused]] int batch_size,
+                              int numThrd, int initQSize) {
+
+    const std::vector<Exploit> &exploit_list = instance.exploits;
+    auto start = std::chrono::system_clock::now();
+
+    unsigned long esize = exploit_list.size();
+    printf("esize is %ld\n",esize);
+
+    std::cout << "Generating Attack Graph" << std::endl;
+
+    ground();
+    const auto &binding_offsets = grounding.binding_offsets;
+    size_t total_groups = grounding.total_groups;
+
+    size_t num_workers = static_cast<size_t>(std::max(numThrd, 1));
+    ThreadPool pool(num_workers);
+    // Every worker counts its precondition checks into its own copy
+    const Selectivity base_stats = selectivity;
+    std::vector<Selectivity> worker_stats(num_workers, selectivity);
+
+    // Frontier size at which work stealing takes over
+    size_t steal_at = std::max(static_cast<size_t>(std::max(initQSize, 0)), 2 * num_workers);
+
+    // Applicable (exploit index, asset group index) pairs of each state or
+    // chunk, kept between iterations so their capacity is reused
+    std::vector<std::vector<std::pair<size_t, size_t>>> matched;
+    std::vector<NetworkState> batch;
+    // IDs of the successors of the current batch, by hash
+    std::unordered_map<size_t, int> batch_ids;
+
+    Budget budget(limits);
+#ifdef REDIS
+    if (use_redis)
+        expand_redis(instance, frontier, *rman, grounding, worker_stats, pool, paths, budget);
+#endif
+    if (deterministic && !budget.stopped())
+        expand_levels(instance, frontier, visited, grounding, worker_stats, pool, paths, budget);
+
+    // Dominance pruning relies on the breadth-first order of this loop, and
+    // on paths that a state's depth or fired exploits do not cut short
+    DominanceIndex dominance_index(grounding, instance.layout);
+    bool prune = dominance && !paths.counts_fired() && paths.max_depth == 0;
+    if (prune && !dominance_index.has_monotone()) {
+        std::cout << "No exploit only adds facts, generating without dominance pruning" << std::endl;
+        prune = false;
+    }
+    if (prune) {
+        for (const auto &factbase : instance.factbases)
+            dominance_index.insert(factbase);
+    }
+
+    // Scratch memory for the containers that only live during one expansion
+    Arena &arena = Arena::local();
+    while (!frontier.empty() && !budget.exceeded(instance.factbases.size(), instance.edges.size())) {//while loop starts
+        if (num_workers > 1 && frontier.size() >= steal_at && !prune) {
+            expand_stealing(instance, frontier, visited, grounding, worker_stats, pool, search_order,
+                            paths, budget);
+            break;
+        }
+
+        // With enough states for every worker, whole states are matched in
+        // parallel (inter-state). Otherwise the groups of the next state are
+        // matched in parallel chunks (intra-state). Either way successors are
+        // built and numbered in the order a single thread would use.
+        size_t states_per_round = 1;
+        size_t chunks = 1;
+        if (num_workers > 1) {
+            if (frontier.size() >= 2 * num_workers)
+                states_per_round = std::min(frontier.size(), num_workers * STATES_PER_WORKER);
+            else if (total_groups >= 2 * MIN_CHUNK)
+                chunks = std::min(num_workers * CHUNKS_PER_WORKER, total_groups / MIN_CHUNK);
+        }
+
+        batch.clear();
+        for (size_t s = 0; s < states_per_round; s++) {
+            // A dominated state keeps the edges into it, but its successors
+            // are reached from the state that dominates it
+            if (prune && dominance_index.dominated(frontier.back().get_factbase()))
+                instance.dominated.push_back(frontier.back().get_id());
+            else
+                batch.push_back(std::move(frontier.back()));
+            frontier.pop_back();
+        }
+        if (batch.empty())
+            continue;
+        if (batch.size() < states_per_round)
+            states_per_round = batch.size();
+
+        size_t tasks = std::max(states_per_round, chunks);
+        if (matched.size() < tasks)
+            matched.resize(tasks);
+        pool.run(tasks, [&](size_t task, size_t worker) {
+            matched[task].clear();
+            if (chunks == 1) {
+                match_bounded(batch[task], paths, grounding, 0, total_groups, worker_stats[worker],
+                              matched[task]);
+            } else {
+                match_bounded(batch[0], paths, grounding, total_groups * task / chunks,
+                              total_groups * (task + 1) / chunks, worker_stats[worker], matched[task]);
+            }
+        });
+        // Chunks cover the groups in order, so joining them keeps group order
+        for (size_t c = 1; c < chunks; c++)
+            matched[0].insert(matched[0].end(), matched[c].begin(), matched[c].end());
+
+        batch_ids.clear();
+        for (size_t s = 0; s < batch.size(); s++) {
+            // Everything from the previous expansion is out of scope by now
+            arena.release();
+            const NetworkState &current_state = batch[s];
+            auto current_hash = current_state.get_hash();
+
+            for (const auto &appl : matched[s]) { //for loop for new states starts
+                NetworkState new_state{current_state, arena.get()};
+                apply_step(grounding, paths, appl.first, appl.second, new_state);
+                auto hash_num = new_state.get_hash();
+                if (hash_num == current_hash)
+                    continue;
+                size_t binding = binding_offsets[appl.first][appl.second];
+                // A successor the batch produced before needs no visited-set probe
+                auto known = batch_ids.find(hash_num);
+                if (known != batch_ids.end()) {
+                    instance.edges.add_unique(current_state.get_id(), known->second, appl.first, binding);
+                    continue;
+                }
+                auto entry = visited.insert_or_get(hash_num, [&] {
                     new_state.set_id();
-                    auto facts_tuple = new_state.get_factbase().get_facts_tuple();
-                    FactbaseItems new_items =
-                        std::make_tuple(facts_tuple, new_state.get_id());
-                    instance.factbase_items.push_back(new_items);
+                    return new_state.get_id();
+                });
+                batch_ids.emplace(hash_num, entry.first);
+                if (entry.second) {
+                    instance.factbase_items.emplace_back(new_state.get_factbase().get_facts_tuple(),
+                                                         new_state.get_id());
                     instance.factbases.push_back(new_state.get_factbase());
-                    hash_map.insert(std::make_pair(new_state.get_hash(instance.facts), new_state.get_id()));
                     frontier.emplace_front(new_state);
-                    Edge ed(current_state.get_id(), new_state.get_id(), exploit, assetGroup);
-                    ed.set_id();
-                    instance.edges.push_back(ed);
-                    counter++;
-            }   
-            else {
-                    int id = hash_map[hash_num];
-                    Edge ed(current_state.get_id(), id, exploit, assetGroup);
-                    ed.set_id();
-                    instance.edges.push_back(ed);
-            }
-        } //for loop for new states ends
+                    if (prune)
+                        dominance_index.insert(new_state.get_factbase());
+                }
+                instance.edges.add_unique(current_state.get_id(), entry.first, appl.first, binding);
+            } //for loop for new states ends
+        }
     }//while loop ends
+    arena.release();
+
+    for (const auto &stats : worker_stats)
+        selectivity.merge(stats, base_stats);
+
+    // States left on the frontier were never expanded, and neither were the
+    // states at the depth bound
+    auto at_bound = [&](uint32_t depth) { return paths.max_depth > 0 && depth >= paths.max_depth; };
+    if (budget.stopped()) {
+        instance.stop_reason = budget.get_reason();
+        instance.unexpanded.reserve(frontier.size());
+        for (const auto &state : frontier) {
+            if (!at_bound(state.get_depth()))
+                instance.unexpanded.push_back(state.get_id());
+        }
+        frontier.clear();
+    }
+    for (const auto &factbase : instance.factbases) {
+        if (at_bound(factbase.get_depth()))
+            instance.unexpanded.push_back(factbase.get_id());
+    }
 
     auto end = std::chrono::system_clock::now();
     std::chrono::duration<double> elapsed_seconds = end - start;
     instance.elapsed_seconds = elapsed_seconds;
 
-    return instance;
+    return std::move(instance);
 }
@@ -1,7 +1,9 @@
 #ifndef AG_GEN_HPP
 #define AG_GEN_HPP
 
+#include <atomic>
 #include <deque>
+#include <functional>
 #include <list>
 #include <unordered_map>
 #include <tuple>
@@ -14,38 +16,126 @@
 #include "exploit.h"
 #include "factbase.h"
 #include "network_state.h"
+#include "selectivity.h"
 
 #include "util/keyvalue.h"
+#include "util/visited_table.h"
 
 #ifdef REDIS
 #include "util/redis_manager.h"
 #endif
 
+// Encoded qualities and topologies of a Factbase, and its ID
 using FactbaseItems =
-    std::tuple<std::tuple<std::vector<Quality>, std::vector<Topology>>, int>;
+    std::tuple<std::tuple<std::vector<Fact>, std::vector<Fact>>, int>;
 
 typedef enum OPERATION_T {
     EQ_T,
     GEQ_T,
     LEQ_T,
     GT_T,
-    LT_T
+    LT_T,
+    NEQ_T
 } OPERATION_T;
 
+// Order in which a work-stealing worker expands its own states
+typedef enum SEARCH_ORDER_T {
+    BREADTH_FIRST_T, // oldest first
+    DEPTH_FIRST_T    // newest first
+} SEARCH_ORDER_T;
+
 struct AGGenInstance {
     std::string opt_network;
     std::vector<Asset> assets;  //init
+    std::vector<size_t> asset_ids; //global IDs of the assets, in order
     std::vector<Factbase> factbases;
     std::vector<Quality> initial_qualities; //init
     std::vector<Topology> initial_topologies; //init
     std::vector<FactbaseItems> factbase_items;
     std::vector<Exploit> exploits; //init
-    std::vector<Edge> edges;
+    EdgeList edges;
     Keyvalue facts; //init
+    FactLayout layout; //init, how facts are encoded for this model
+
+    std::vector<int> unexpanded; //IDs of the states left on the frontier when a limit stopped generation
+    std::string stop_reason; //the limit that stopped generation, empty if the graph is complete
+    std::vector<int> dominated; //IDs of the states dominance pruning did not expand
 
     std::chrono::duration<double> elapsed_seconds;
 };
 
+/**
+ * @brief Budget of a generation run, 0 meaning no limit
+ */
+struct GenerationLimits {
+    size_t max_states = 0;
+    size_t max_edges = 0;
+    size_t max_rss = 0;     //!< Resident memory in bytes
+    double max_seconds = 0;
+};
+
+/**
+ * @brief Bounds on the attack paths generation follows, 0 meaning no bound
+ * @details A path is the one a state was first reached by. States at
+ *          max_depth are kept but not expanded, and an exploit that fired
+ *          max_fired times along the path to a state does not fire from it.
+ */
+struct PathLimits {
+    size_t max_depth = 0;
+    //! Per exploit, up to NetworkState::MAX_FIRED, SIZE_MAX for none, or empty for no limits at all
+    std::vector<size_t> max_fired;
+
+    bool counts_fired() const { return !max_fired.empty(); }
+};
+
+/** Budget class
+ * @brief Checks a run against its GenerationLimits
+ * @details State and edge counts and the elapsed time are cheap to check,
+ *          while resident memory is read from /proc, so it is only sampled
+ *          every RSS_INTERVAL checks. Once a limit is reached the budget
+ *          stays exceeded, so every worker sees the same outcome. Safe to
+ *          call from several threads.
+ */
+class Budget {
+    static constexpr uint64_t RSS_INTERVAL = 64;
+
+    const GenerationLimits &limits;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<uint64_t> checks{0};
+    std::atomic<const char *> reason{nullptr};
+
+  public:
+    explicit Budget(const GenerationLimits &limits)
+        : limits(limits), start(std::chrono::steady_clock::now()) {}
+
+    bool exceeded(size_t states, size_t edges);
+
+    bool stopped() const { return reason.load() != nullptr; }
+
+    /**
+     * @return The name of the limit that was reached, or null
+     */
+    const char *get_reason() const { return reason.load(); }
+};
+
+/**
+ * @brief The asset groups of every exploit, grounded once per generator
+ */
+struct Grounding {
+    std::vector<std::vector<AssetGroup>> exploit_groups;
+    std::vector<std::vector<size_t>> binding_offsets; //!< Offset of each group's binding in the edge pool
+    std::vector<size_t> group_start; //!< Flat number of each exploit's first group
+    size_t total_groups = 0;
+};
+
+/**
+ * @brief Scratch space of one thread matching states with AGGen::match()
+ */
+struct MatchScratch {
+    Selectivity stats;                                 //!< This thread's precondition counters
+    std::vector<std::pair<size_t, size_t>> applicable; //!< Exploit and asset group of every match
+};
+
 /** AGGen class
  * @brief Generate attack graph
  * @details Main generator class that stores state for the entire graph
@@ -54,21 +144,78 @@ struct AGGenInstance {
 class AGGen {
     AGGenInstance instance;
     std::deque<NetworkState> frontier;               //!< Unexplored states
-    std::unordered_map<size_t, int> hash_map{};      //!< Map of hashes to Factbase ID
+    VisitedTable visited;                            //!< Map of hashes to Factbase ID
+    Selectivity selectivity;                         //!< Precondition counters and check order
+    SEARCH_ORDER_T search_order = BREADTH_FIRST_T;   //!< Local order of work-stealing workers
+    bool deterministic = false;                      //!< Level-synchronous expansion, stable IDs
+    bool dominance = false;                          //!< Skip states another state dominates
+    GenerationLimits limits;                         //!< When to stop early
+    PathLimits paths;                                //!< Which paths to follow
+    Grounding grounding;                             //!< Built by ground()
+    std::vector<std::pair<size_t, size_t>> applicable; //!< Scratch space of expand()
 
     bool use_redis;
 #ifdef REDIS
     RedisManager *rman;
 #endif
 
+    void init_asset_ids();
+    void ground();
+
   public:
-    explicit AGGen(AGGenInstance &_instance);
+    explicit AGGen(const AGGenInstance &_instance);
 
 #ifdef REDIS
-    AGGen(AGGenInstance &_instance, RedisManager &_rman);
+    AGGen(const AGGenInstance &_instance, RedisManager &_rman);
 #endif
 
-    AGGenInstance &generate(bool batch_process, int batch_num, int numThrd, int initQSize);
+    AGGenInstance generate(bool batch_process, int batch_num, int numThrd, int initQSize);
+
+    //! Called with the exploit index, asset group index and new state of a successor
+    using Successor = std::function<void(size_t, size_t, NetworkState &)>;
+
+    void expand(const NetworkState &state, const Successor &emit);
+
+    MatchScratch make_scratch();
+    void match(const NetworkState &state, MatchScratch &scratch) const;
+    void apply(size_t exploit, size_t group, NetworkState &state) const;
+
+    /**
+     * @return The assets an asset group binds to its exploit's parameters
+     */
+    const std::vector<size_t> &get_perm(size_t exploit, size_t group) const {
+        return grounding.exploit_groups[exploit][group].get_perm();
+    }
+
+    void set_search_order(SEARCH_ORDER_T order) { search_order = order; }
+
+    /**
+     * @brief Makes state and edge IDs independent of the number of threads
+     */
+    void set_deterministic(bool enable) { deterministic = enable; }
+
+    /**
+     * @brief Stops generation once any of the limits is reached
+     */
+    void set_limits(const GenerationLimits &budget) { limits = budget; }
+
+    /**
+     * @brief Bounds the length of attack paths and how often exploits fire on them
+     */
+    void set_path_limits(const PathLimits &bounds) { paths = bounds; }
+
+    /**
+     * @brief Skips expanding states that a known state dominates on monotone attributes
+     */
+    void set_dominance(bool enable) { dominance = enable; }
+
+    /**
+     * @brief Sizes the visited-state table for an expected number of states
+     */
+    void reserve_states(size_t expected) { visited.reserve(expected); }
+
+    void load_stats(const std::string &path) { selectivity.load(path); }
+    void save_stats(const std::string &path) const { selectivity.save(path); }
 };
 
 #endif // AG_GEN_HPP
@@ -22,7 +22,7 @@ using namespace std;
 Asset::Asset(std::string nname, std::vector<Quality> q)
     : name(move(nname)), qualities(std::move(q)) {}
 
-std::string Asset::get_name()
+const std::string &Asset::get_name() const
 {
 
     return name;
@@ -19,7 +19,7 @@ class Asset {
   public:
     Asset(std::string nname, std::vector<Quality> q);
 
-    std::string get_name();
+    const std::string &get_name() const;
 };
 
 #endif // ASSET_HPP
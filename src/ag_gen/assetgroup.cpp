@@ -14,16 +14,15 @@ using namespace std;
 
 /**
  * @brief Prints information about the Asset Group
- * @details prints all of the hypothetical qualities of an Asset Group, then
- *          prints all of the hypothetical topologies
+ * @details prints all of the encoded preconditions of an Asset Group, in the
+ *          order they are checked by default
  */
 void AssetGroup::print_facts() {
-    for (auto &quality : this->get_hypo_quals()) {
-        quality.print();
-    }
-
-    for (auto &topology : this->get_hypo_topos()) {
-        topology.print();
+    for (const auto &cond : this->get_preconditions()) {
+        cout << (cond.topology ? "topology: " : "quality: ") << fact_to_string(cond.fact);
+        if (cond.values)
+            cout << " (compared)";
+        cout << endl;
     }
     cout << endl;
 }
@@ -5,21 +5,51 @@
 #ifndef AG_GEN_ASSET_GROUP_H
 #define AG_GEN_ASSET_GROUP_H
 
+#include <memory>
 #include <vector>
 
-#include "quality.h"
-#include "topology.h"
+#include "encoding.h"
+
+#include "util/build_sql.h"
+
+/**
+ * @brief A postcondition grounded to a set of assets and encoded
+ */
+struct GroundedFact {
+    ACTION_T action;
+    Fact fact;
+};
+
+/**
+ * @brief A precondition grounded to a set of assets and encoded
+ * @details Without values, the precondition holds if the factbase contains
+ *          fact. With values, fact is a key (a fact with its value cleared)
+ *          and the precondition holds for any fact with that key whose value
+ *          is one of the sorted Keyvalue IDs in values. The IDs are computed
+ *          once per exploit and shared by its groups.
+ */
+struct GroundedCondition {
+    Fact fact;
+    bool topology; //!< Whether fact is a topology rather than a quality
+    std::shared_ptr<const std::vector<int>> values;
+};
 
 /** AssetGroup class
  * @brief Holds information about multiple Assets
- * @details Holds the hypothetical qualities and topologies of
- *          multiple Assets as well as a vector of the number IDs of the Assets.
- *          It also implements a print method for the qualities and topologies
- *          and for the Assets.
+ * @details Holds an exploit's preconditions and postconditions grounded to
+ *          a permutation of Assets, as well as the number IDs of the Assets.
+ *          Facts are encoded the way a Factbase stores them, so checking the
+ *          preconditions and firing the postconditions only touch integers.
+ *          It also implements a print method for the facts and for the Assets.
+ *
+ *          Every AssetGroup of an exploit lists its preconditions in the same
+ *          order, so a precondition can be referred to by its position.
  */
 class AssetGroup {
-    std::vector<Quality> hypothetical_qualities;
-    std::vector<Topology> hypothetical_topologies;
+    std::vector<GroundedCondition> preconditions;
+
+    std::vector<GroundedFact> postcond_qualities;
+    std::vector<GroundedFact> postcond_topologies;
 
     std::vector<size_t> perm;
 
@@ -28,23 +58,28 @@ class AssetGroup {
      * @brief Constructor for AssetGroup
      * @details Initializes values of AssetGroup
      *
-     * @param hypo_quals The hypothetical qualities of Assets
-     * @param hypo_topos The hyptothetcial topologies of Assets
+     * @param preconds The encoded preconditions, qualities and topologies
+     * @param post_quals The encoded quality postconditions
+     * @param post_topos The encoded topology postconditions
      * @param pperm IDs of the Assets
      */
-    AssetGroup(std::vector<Quality> hypo_quals,
-               std::vector<Topology> hypo_topos, std::vector<size_t> pperm)
-        : hypothetical_qualities(move(hypo_quals)),
-          hypothetical_topologies(move(hypo_topos)), perm(move(pperm)) {}
+    AssetGroup(std::vector<GroundedCondition> preconds, std::vector<GroundedFact> post_quals,
+               std::vector<GroundedFact> post_topos, std::vector<size_t> pperm)
+        : preconditions(move(preconds)), postcond_qualities(move(post_quals)),
+          postcond_topologies(move(post_topos)), perm(move(pperm)) {}
 
-    std::vector<size_t> get_perm() const { return perm; }
+    const std::vector<size_t> &get_perm() const { return perm; }
+
+    const std::vector<GroundedCondition> &get_preconditions() const {
+        return preconditions;
+    }
 
-    std::vector<Quality> get_hypo_quals() const {
-        return hypothetical_qualities;
+    const std::vector<GroundedFact> &get_postcond_quals() const {
+        return postcond_qualities;
     }
 
-    std::vector<Topology> get_hypo_topos() const {
-        return hypothetical_topologies;
+    const std::vector<GroundedFact> &get_postcond_topos() const {
+        return postcond_topologies;
     }
 
     void print_facts();
@@ -0,0 +1,345 @@
+// component.cpp splits a network model into independent components, generates
+// each component's attack graph separately and recombines the results either
+// as a disjoint union of component graphs or as their full product
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "component.h"
+
+/**
+ * @brief Minimal union-find over a contiguous range of indices.
+ */
+class DisjointSet {
+    std::vector<size_t> parent;
+
+  public:
+    explicit DisjointSet(size_t n) : parent(n) {
+        std::iota(parent.begin(), parent.end(), 0);
+    }
+
+    size_t find(size_t x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    void join(size_t a, size_t b) { parent[find(a)] = find(b); }
+};
+
+/**
+ * @brief Checks whether an exploit can bind assets from different components
+ * @details A multi-parameter exploit only stays inside one component when all
+ *          of its parameters are linked by topology preconditions. Otherwise a
+ *          binding may span unconnected assets and the model cannot be split.
+ *
+ * @param ex The exploit to check
+ * @return True if the exploit may bind unconnected assets
+ */
+static bool spans_components(Exploit &ex) {
+    size_t num_params = ex.get_num_params();
+    if (num_params < 2)
+        return false;
+
+    DisjointSet params(num_params);
+    for (auto &precond : ex.precond_list_t())
+        params.join(precond.from_param, precond.to_param);
+
+    for (size_t i = 1; i < num_params; i++) {
+        if (params.find(i) != params.find(0))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Splits an instance into independent components
+ * @details Assets are grouped by the initial topologies connecting them. If
+ *          any exploit can bind assets that are not linked by a topology, the
+ *          whole model is returned as a single component. Each component keeps
+ *          the global asset IDs, the full exploit list and the shared Keyvalue.
+ *
+ * @param instance The loaded instance
+ * @return One instance per component
+ */
+std::vector<AGGenInstance> decompose_instance(const AGGenInstance &instance) {
+    size_t num_assets = instance.assets.size();
+    DisjointSet assets(num_assets);
+
+    auto exploits = instance.exploits;
+    bool single = std::any_of(exploits.begin(), exploits.end(), spans_components);
+
+    for (auto &topo : instance.initial_topologies) {
+        assets.join(topo.get_from_asset_id(), topo.get_to_asset_id());
+    }
+
+    std::unordered_map<size_t, size_t> root_to_component;
+    std::vector<size_t> component_of(num_assets, 0);
+    for (size_t i = 0; i < num_assets; i++) {
+        size_t root = single ? 0 : assets.find(i);
+        auto it = root_to_component.find(root);
+        if (it == root_to_component.end())
+            it = root_to_component.emplace(root, root_to_component.size()).first;
+        component_of[i] = it->second;
+    }
+
+    std::vector<AGGenInstance> components(root_to_component.size());
+    for (auto &comp : components) {
+        comp.opt_network = instance.opt_network;
+        comp.exploits = instance.exploits;
+        comp.facts = instance.facts;
+        comp.layout = instance.layout;
+    }
+
+    for (size_t i = 0; i < num_assets; i++) {
+        auto &comp = components[component_of[i]];
+        comp.assets.push_back(instance.assets[i]);
+        comp.asset_ids.push_back(i);
+    }
+
+    for (auto &qual : instance.initial_qualities) {
+        components[component_of[qual.get_asset_id()]].initial_qualities.push_back(qual);
+    }
+
+    for (auto &topo : instance.initial_topologies) {
+        components[component_of[topo.get_from_asset_id()]].initial_topologies.push_back(topo);
+    }
+
+    return components;
+}
+
+/**
+ * @brief Generates the attack graph of every component
+ * @details Components are generated in parallel, with at most numThrd
+ *          components running at once. The threads are shared out between
+ *          the components that run together.
+ *
+ *          State and Edge IDs come from global counters, so in deterministic
+ *          mode the components are generated one after another instead, each
+ *          with every thread.
+ *
+ *          Limits and path bounds apply to every component on its own: each
+ *          component may generate max_states states, and a path is bounded
+ *          by the steps taken within its component.
+ *
+ * @return The generated instance of each component, in component order
+ */
+std::vector<AGGenInstance> generate_components(std::vector<AGGenInstance> &components,
+                                               bool batch_process, int batch_size,
+                                               int numThrd, int initQSize, bool deterministic,
+                                               const GenerationLimits &limits, const PathLimits &paths) {
+    std::vector<AGGenInstance> results(components.size());
+    if (deterministic) {
+        for (size_t i = 0; i < components.size(); i++) {
+            AGGen gen(components[i]);
+            gen.set_deterministic(true);
+            gen.set_limits(limits);
+            gen.set_path_limits(paths);
+            results[i] = gen.generate(batch_process, batch_size, numThrd, initQSize);
+        }
+        return results;
+    }
+
+    size_t max_threads = static_cast<size_t>(std::max(numThrd, 1));
+
+    for (size_t start = 0; start < components.size(); start += max_threads) {
+        size_t end = std::min(start + max_threads, components.size());
+        std::vector<std::thread> workers;
+        // Threads left over once every component has one match in parallel
+        int component_threads = static_cast<int>(std::max<size_t>(max_threads / (end - start), 1));
+        for (size_t i = start; i < end; i++) {
+            workers.emplace_back([&, i]() {
+                AGGen gen(components[i]);
+                gen.set_limits(limits);
+                gen.set_path_limits(paths);
+                results[i] = gen.generate(batch_process, batch_size, component_threads, initQSize);
+            });
+        }
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    return results;
+}
+
+/**
+ * @return The number of states in the product of the component graphs, as a
+ *         double since it quickly outgrows any integer type
+ */
+double product_size(const std::vector<AGGenInstance> &components) {
+    double total = 1;
+    for (auto &comp : components)
+        total *= comp.factbases.size();
+    return total;
+}
+
+/**
+ * @brief Gathers the assets of every component back into global ID order
+ */
+static std::vector<Asset> collect_assets(const std::vector<AGGenInstance> &components) {
+    std::vector<std::pair<size_t, const Asset *>> ordered;
+    for (auto &comp : components) {
+        for (size_t i = 0; i < comp.assets.size(); i++)
+            ordered.emplace_back(comp.asset_ids[i], &comp.assets[i]);
+    }
+    std::sort(ordered.begin(), ordered.end(),
+              [](const std::pair<size_t, const Asset *> &a,
+                 const std::pair<size_t, const Asset *> &b) { return a.first < b.first; });
+
+    std::vector<Asset> assets;
+    assets.reserve(ordered.size());
+    for (auto &entry : ordered)
+        assets.push_back(*entry.second);
+    return assets;
+}
+
+/**
+ * @brief Stores the component graphs side by side in one instance
+ * @details Factbase and Edge IDs are globally unique, so the component graphs
+ *          are concatenated as they are. Each stored state only holds the facts
+ *          of its own component.
+ */
+AGGenInstance merge_components(std::vector<AGGenInstance> &components) {
+    AGGenInstance merged;
+    if (components.empty())
+        return merged;
+
+    merged.opt_network = components[0].opt_network;
+    merged.facts = components[0].facts;
+    merged.layout = components[0].layout;
+    merged.exploits = components[0].exploits;
+    merged.assets = collect_assets(components);
+
+    for (auto &comp : components) {
+        std::move(comp.factbases.begin(), comp.factbases.end(), std::back_inserter(merged.factbases));
+        std::move(comp.factbase_items.begin(), comp.factbase_items.end(),
+                  std::back_inserter(merged.factbase_items));
+        merged.edges.append(comp.edges);
+        merged.unexpanded.insert(merged.unexpanded.end(), comp.unexpanded.begin(), comp.unexpanded.end());
+        if (merged.stop_reason.empty())
+            merged.stop_reason = comp.stop_reason;
+    }
+
+    return merged;
+}
+
+/**
+ * @brief Expands the component graphs into the full product graph
+ * @details A product state picks one state from every component. Every
+ *          component edge is replicated once for each combination of the
+ *          other components' states. A product state misses successors when
+ *          any of its component states was not expanded, so it is listed as
+ *          unexpanded then.
+ *
+ * @throw std::overflow_error if the product has more states or edges than
+ *        int IDs can number
+ */
+AGGenInstance expand_components(std::vector<AGGenInstance> &components) {
+    AGGenInstance product;
+    if (components.empty())
+        return product;
+
+    // Checked before anything is allocated, in floating point so it cannot wrap
+    double states = product_size(components);
+    double edges = 0;
+    for (auto &comp : components)
+        edges += comp.edges.size() * (states / comp.factbases.size());
+    constexpr double max_id = std::numeric_limits<int>::max();
+    if (states > max_id || edges > max_id) {
+        std::ostringstream msg;
+        msg << "The product graph has " << states << " states and " << edges
+            << " edges, more than int IDs can number";
+        throw std::overflow_error(msg.str());
+    }
+
+    product.opt_network = components[0].opt_network;
+    product.facts = components[0].facts;
+    product.layout = components[0].layout;
+    product.exploits = components[0].exploits;
+
+    size_t num_comps = components.size();
+    std::vector<size_t> stride(num_comps, 1);
+    for (size_t i = 1; i < num_comps; i++)
+        stride[i] = stride[i - 1] * components[i - 1].factbases.size();
+
+    // Local edge lists per component, keyed by the local index of the source
+    std::vector<std::vector<std::vector<std::pair<size_t, size_t>>>> out_edges(num_comps);
+    // Whether each component state was left unexpanded, by local index
+    std::vector<std::vector<char>> unexpanded(num_comps);
+    for (size_t i = 0; i < num_comps; i++) {
+        auto &comp = components[i];
+        std::unordered_map<int, size_t> local;
+        for (size_t s = 0; s < comp.factbases.size(); s++)
+            local[comp.factbases[s].get_id()] = s;
+        unexpanded[i].assign(comp.factbases.size(), 0);
+        for (int id : comp.unexpanded)
+            unexpanded[i][local[id]] = 1;
+        if (product.stop_reason.empty())
+            product.stop_reason = comp.stop_reason;
+
+        out_edges[i].resize(comp.factbases.size());
+        for (size_t e = 0; e < comp.edges.size(); e++) {
+            out_edges[i][local[comp.edges.get_from_id(e)]].emplace_back(local[comp.edges.get_to_id(e)], e);
+        }
+    }
+
+    size_t total = static_cast<size_t>(states);
+    std::vector<int> product_ids(total);
+    std::vector<size_t> digits(num_comps, 0);
+
+    for (size_t s = 0; s < total; s++) {
+        std::vector<Fact> quals;
+        std::vector<Fact> topos;
+        bool partial = false;
+        for (size_t i = 0; i < num_comps; i++) {
+            auto facts = components[i].factbases[digits[i]].get_facts_tuple();
+            auto &q = std::get<0>(facts);
+            auto &t = std::get<1>(facts);
+            quals.insert(quals.end(), q.begin(), q.end());
+            topos.insert(topos.end(), t.begin(), t.end());
+            partial |= unexpanded[i][digits[i]] != 0;
+        }
+
+        NetworkState state(quals, topos, product.layout);
+        state.set_id();
+        product_ids[s] = state.get_id();
+        if (partial)
+            product.unexpanded.push_back(state.get_id());
+        product.factbases.push_back(state.get_factbase());
+        product.factbase_items.push_back(
+            std::make_tuple(state.get_factbase().get_facts_tuple(), state.get_id()));
+
+        for (size_t i = 0; i < num_comps && ++digits[i] == components[i].factbases.size(); i++)
+            digits[i] = 0;
+    }
+
+    std::vector<size_t> binding_base(num_comps);
+    for (size_t i = 0; i < num_comps; i++)
+        binding_base[i] = product.edges.import_bindings(components[i].edges);
+
+    for (size_t s = 0; s < total; s++) {
+        for (size_t i = 0; i < num_comps; i++) {
+            auto &comp_edges = components[i].edges;
+            size_t digit = (s / stride[i]) % components[i].factbases.size();
+            for (auto &local_edge : out_edges[i][digit]) {
+                size_t t = s - digit * stride[i] + local_edge.first * stride[i];
+                product.edges.add(product_ids[s], product_ids[t], comp_edges.get_exploit(local_edge.second),
+                                  binding_base[i] + comp_edges.get_binding(local_edge.second));
+            }
+        }
+    }
+
+    product.assets = collect_assets(components);
+
+    return product;
+}
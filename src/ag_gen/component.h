@@ -0,0 +1,25 @@
+// component.h declares the functions used to split a network model into
+// independent components and to recombine the generated component graphs
+
+#ifndef AG_GEN_COMPONENT_H
+#define AG_GEN_COMPONENT_H
+
+#include <vector>
+
+#include "ag_gen.h"
+
+std::vector<AGGenInstance> decompose_instance(const AGGenInstance &instance);
+
+std::vector<AGGenInstance> generate_components(std::vector<AGGenInstance> &components,
+                                               bool batch_process, int batch_size,
+                                               int numThrd, int initQSize,
+                                               bool deterministic = false,
+                                               const GenerationLimits &limits = GenerationLimits(),
+                                               const PathLimits &paths = PathLimits());
+
+AGGenInstance merge_components(std::vector<AGGenInstance> &components);
+AGGenInstance expand_components(std::vector<AGGenInstance> &components);
+
+double product_size(const std::vector<AGGenInstance> &components);
+
+#endif // AG_GEN_COMPONENT_H
@@ -0,0 +1,63 @@
+// cycles.cpp finds the back edges of a depth-first search over the edges of
+// a generated attack graph and removes them, leaving an acyclic graph
+
+#include <cstdint>
+#include <vector>
+
+#include "cycles.h"
+#include "graph.h"
+
+/**
+ * @brief Removes the edges that close cycles from a generated graph
+ * @details Runs a depth-first search over the states in the order of their
+ *          IDs, following the edges out of a state in the order of their IDs,
+ *          and removes every back edge, an edge into a state still on the
+ *          search stack. This is the order the graph loaded from the database
+ *          is searched in, so the same edges go as when cycles were removed
+ *          from the stored graph, but they are never written in the first
+ *          place.
+ *
+ *          The search runs over the StateGraph of the instance and keeps an
+ *          explicit stack, so it takes a few arrays of the size of the graph
+ *          and no recursion. Edges to or from a state that is not in the
+ *          instance are kept.
+ *
+ * @param instance A generated graph, whose edges are changed in place
+ * @return The number of edges removed
+ */
+size_t remove_cycles(AGGenInstance &instance) {
+    StateGraph graph(instance);
+    size_t num_vertices = graph.num_vertices();
+
+    enum : uint8_t { WHITE, GRAY, BLACK };
+    std::vector<uint8_t> color(num_vertices, WHITE);
+    std::vector<size_t> next(num_vertices); // next out edge to follow
+    for (size_t v = 0; v < num_vertices; v++)
+        next[v] = graph.begin(v);
+    std::vector<uint32_t> stack;
+    std::vector<char> removed(instance.edges.size(), 0);
+    for (uint32_t root = 0; root < num_vertices; root++) {
+        if (color[root] != WHITE)
+            continue;
+        color[root] = GRAY;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t v = stack.back();
+            if (next[v] == graph.end(v)) {
+                color[v] = BLACK;
+                stack.pop_back();
+                continue;
+            }
+            size_t slot = next[v]++;
+            uint32_t t = graph.get_target(slot);
+            if (color[t] == WHITE) {
+                color[t] = GRAY;
+                stack.push_back(t);
+            } else if (color[t] == GRAY) {
+                removed[graph.get_source(slot)] = 1;
+            }
+        }
+    }
+
+    return instance.edges.remove(removed);
+}
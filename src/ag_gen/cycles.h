@@ -0,0 +1,13 @@
+// cycles.h declares the removal of the edges that close cycles in a
+// generated attack graph, done in memory before the graph is saved
+
+#ifndef AG_GEN_CYCLES_H
+#define AG_GEN_CYCLES_H
+
+#include <cstddef>
+
+#include "ag_gen.h"
+
+size_t remove_cycles(AGGenInstance &instance);
+
+#endif // AG_GEN_CYCLES_H
@@ -0,0 +1,164 @@
+// dominance.cpp finds monotone attributes and keeps the set trie of generated
+// states that dominance pruning looks up
+
+#include <algorithm>
+#include <tuple>
+
+#include <boost/functional/hash.hpp>
+
+#include "dominance.h"
+
+size_t FactHash::operator()(Fact f) const {
+    size_t seed = 0;
+    boost::hash_combine(seed, static_cast<uint64_t>(f));
+    boost::hash_combine(seed, static_cast<uint64_t>(f >> 64));
+    return seed;
+}
+
+size_t FactHash::operator()(const std::vector<Fact> &facts) const {
+    size_t seed = facts.size();
+    for (auto f : facts)
+        boost::hash_combine(seed, (*this)(f));
+    return seed;
+}
+
+/**
+ * @brief Finds the monotone attributes of a model
+ * @details Attributes and properties that a grounded postcondition updates or
+ *          deletes are not monotone, every other one is.
+ *
+ * @param grounding The grounded exploits of the model
+ * @param layout How the model's facts are encoded
+ */
+DominanceIndex::DominanceIndex(const Grounding &grounding, const FactLayout &layout) : layout(layout) {
+    for (const auto &groups : grounding.exploit_groups) {
+        for (const auto &group : groups) {
+            for (const auto &qual : group.get_postcond_quals()) {
+                if (qual.action != ADD_T)
+                    updated_qualities.insert(layout.decode_quality(qual.fact).attr);
+            }
+            for (const auto &topo : group.get_postcond_topos()) {
+                if (topo.action != ADD_T)
+                    updated_topologies.insert(layout.decode_topology(topo.fact).property);
+            }
+        }
+    }
+    for (const auto &groups : grounding.exploit_groups) {
+        for (const auto &group : groups) {
+            for (const auto &qual : group.get_postcond_quals())
+                monotone |= !updated_qualities.count(layout.decode_quality(qual.fact).attr);
+            for (const auto &topo : group.get_postcond_topos())
+                monotone |= !updated_topologies.count(layout.decode_topology(topo.fact).property);
+        }
+    }
+}
+
+/**
+ * @brief Splits a state into its facts of attributes that are not monotone
+ *        and the sorted numbers of its monotone facts
+ * @details The first element of the signature is the number of qualities in
+ *          it, so that a quality and a topology with the same encoding do not
+ *          give the same signature.
+ *
+ * @param number_new Whether to number monotone facts seen for the first time
+ * @return False if a monotone fact has no number yet, so no known state has it
+ */
+bool DominanceIndex::split(const Factbase &factbase, bool number_new) {
+    auto facts = factbase.get_facts_tuple();
+    signature.assign(1, 0);
+    numbers.clear();
+
+    auto take = [&](const std::vector<Fact> &list, const std::unordered_set<int> &updated,
+                    std::unordered_map<Fact, uint32_t, FactHash> &numbered, bool quality) {
+        for (auto f : list) {
+            int attr = quality ? layout.decode_quality(f).attr : layout.decode_topology(f).property;
+            if (updated.count(attr)) {
+                signature.push_back(f);
+                continue;
+            }
+            auto it = numbered.find(f);
+            if (it == numbered.end()) {
+                if (!number_new)
+                    return false;
+                uint32_t next = static_cast<uint32_t>(quality_numbers.size() + topology_numbers.size()) + 1;
+                it = numbered.emplace(f, next).first;
+            }
+            numbers.push_back(it->second);
+        }
+        return true;
+    };
+    if (!take(std::get<0>(facts), updated_qualities, quality_numbers, true))
+        return false;
+    signature[0] = signature.size() - 1;
+    if (!take(std::get<1>(facts), updated_topologies, topology_numbers, false))
+        return false;
+    std::sort(numbers.begin(), numbers.end());
+    return true;
+}
+
+/**
+ * @brief Adds a generated state to the index
+ */
+void DominanceIndex::insert(const Factbase &factbase) {
+    split(factbase, true);
+    auto &nodes = groups[signature].nodes;
+    uint32_t node = 0;
+    for (uint32_t label : numbers) {
+        // Find the child with this label, or link a new one in label order
+        uint32_t *link = &nodes[node].child;
+        while (*link && nodes[*link].label < label)
+            link = &nodes[*link].sibling;
+        if (*link && nodes[*link].label == label) {
+            node = *link;
+            continue;
+        }
+        Node added;
+        added.label = label;
+        added.sibling = *link;
+        node = static_cast<uint32_t>(nodes.size());
+        *link = node; // before the push_back, which may move the nodes
+        nodes.push_back(added);
+    }
+}
+
+/**
+ * @brief Checks whether a known state dominates a state
+ * @details Searches the trie of the state's signature for a path that holds
+ *          every monotone fact of the state and at least one more. Children
+ *          with a lower label than the next fact asked for may be skipped
+ *          over, and a higher label ends the branch, as paths are sorted. A
+ *          state equal to the one asked for does not dominate it.
+ *
+ * @return Whether a known state strictly dominates the state
+ */
+bool DominanceIndex::dominated(const Factbase &factbase) {
+    if (!split(factbase, false))
+        return false;
+    auto group = groups.find(signature);
+    if (group == groups.end())
+        return false;
+    const auto &nodes = group->second.nodes;
+
+    // Node, number of facts matched on the way to it, whether a fact was skipped
+    std::vector<std::tuple<uint32_t, size_t, bool>> stack{{0, 0, false}};
+    while (!stack.empty()) {
+        uint32_t node;
+        size_t matched;
+        bool skipped;
+        std::tie(node, matched, skipped) = stack.back();
+        stack.pop_back();
+        if (matched == numbers.size()) {
+            // Every path through the node goes on to a state, so a child means more facts
+            if (skipped || nodes[node].child)
+                return true;
+            continue;
+        }
+        for (uint32_t c = nodes[node].child; c && nodes[c].label <= numbers[matched]; c = nodes[c].sibling) {
+            if (nodes[c].label == numbers[matched])
+                stack.emplace_back(c, matched + 1, skipped);
+            else
+                stack.emplace_back(c, matched, true);
+        }
+    }
+    return false;
+}
@@ -0,0 +1,76 @@
+// dominance.h declares the index of generated states that dominance pruning
+// asks for a state whose facts are a strict superset of another's
+
+#ifndef AG_GEN_DOMINANCE_H
+#define AG_GEN_DOMINANCE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ag_gen.h"
+
+struct FactHash {
+    size_t operator()(Fact f) const;
+    size_t operator()(const std::vector<Fact> &facts) const;
+};
+
+/** DominanceIndex class
+ * @brief Finds the states that another known state dominates
+ * @details An attribute is monotone when no exploit updates or deletes it, so
+ *          its facts are only ever added, and preconditions only ask for facts
+ *          to be present. A state B then dominates a state A when both have
+ *          the same facts of the other attributes and B has every monotone
+ *          fact of A and more: any exploit that fires from A fires from B, and
+ *          leads to a state that dominates or equals A's successor. Every fact
+ *          reachable from A is reachable from B.
+ *
+ *          States are grouped by their facts of attributes that are not
+ *          monotone. Within a group the monotone facts of every state are
+ *          numbered, sorted and kept in a set trie, where a state is a path
+ *          from the root, so a superset query only follows the branches that
+ *          can still hold the facts it asks for. Facts get their numbers in
+ *          the order they are first seen, so the facts of the initial state
+ *          make up the shared prefix of most paths.
+ */
+class DominanceIndex {
+    struct Node {
+        uint32_t label = 0;
+        uint32_t child = 0;   //!< First child, children are sorted by label
+        uint32_t sibling = 0; //!< Next child of the same parent, 0 for none
+    };
+
+    //! Trie of the states sharing one set of facts of attributes that are not monotone
+    struct SetTrie {
+        std::vector<Node> nodes{Node{}}; //!< nodes[0] is the root
+    };
+
+    std::unordered_set<int> updated_qualities;  //!< Attributes that are not monotone
+    std::unordered_set<int> updated_topologies; //!< Properties that are not monotone
+    FactLayout layout;
+    bool monotone = false; //!< Some exploit adds facts of a monotone attribute
+
+    std::unordered_map<Fact, uint32_t, FactHash> quality_numbers;
+    std::unordered_map<Fact, uint32_t, FactHash> topology_numbers;
+    std::unordered_map<std::vector<Fact>, SetTrie, FactHash> groups;
+
+    std::vector<Fact> signature;   //!< Scratch space of split()
+    std::vector<uint32_t> numbers; //!< Scratch space of split()
+
+    bool split(const Factbase &factbase, bool number_new);
+
+  public:
+    DominanceIndex(const Grounding &grounding, const FactLayout &layout);
+
+    /**
+     * @return Whether exploits add facts of a monotone attribute, without
+     *         which no state dominates another
+     */
+    bool has_monotone() const { return monotone; }
+
+    void insert(const Factbase &factbase);
+    bool dominated(const Factbase &factbase);
+};
+
+#endif // AG_GEN_DOMINANCE_H
@@ -3,88 +3,250 @@
 //
 
 #include <iostream>
+#include <stdexcept>
 
 #include "edge.h"
 #include "util/db.h"
 
+std::atomic<int> EdgeList::current_id{0};
+
 /**
- * @brief Constructor for Edge
- * @details Initializes information with given parameters and initializes id to
- * 0.
- *
- * @param iFrom The From Node
- * @param iTo The To Node
- * @param ex Exploit associated with the Edge
- * @param ag AssetGroup associated with the Edge
+ * @brief Checks that a pool grown by some entries still has 32-bit offsets
+ * @throw std::overflow_error if it would not
  */
-Edge::Edge(int iFrom, int iTo, Exploit &ex, AssetGroup &ag)
-    : from_node(iFrom), to_node(iTo), exploit(ex), assetGroup(ag), deleted(false) {}
+void EdgeList::check_pool(size_t added) const {
+    if (added > UINT32_MAX - binding_pool.size())
+        throw std::overflow_error("Asset binding pool past " + std::to_string(UINT32_MAX) +
+                                  " entries, more than edges can point into");
+}
 
 /**
- * @return The Edge ID
+ * @brief Adds an asset binding to the pool
+ *
+ * @param perm The assets bound to each exploit parameter
+ * @return The offset of the binding, for use with add()
  */
-int Edge::get_id() { return id; }
-
-void Edge::set_deleted() { deleted = true; }
+size_t EdgeList::add_binding(const std::vector<size_t> &perm) {
+    check_pool(perm.size());
+    size_t offset = binding_pool.size();
+    binding_pool.insert(binding_pool.end(), perm.begin(), perm.end());
+    return offset;
+}
 
-bool Edge::is_deleted() { return deleted; }
+/**
+ * @brief Copies the binding pool of another EdgeList to the end of this one
+ *
+ * @param other The EdgeList whose bindings are copied
+ * @return The amount to add to the other list's binding offsets
+ */
+size_t EdgeList::import_bindings(const EdgeList &other) {
+    check_pool(other.binding_pool.size());
+    size_t base = binding_pool.size();
+    binding_pool.insert(binding_pool.end(), other.binding_pool.begin(), other.binding_pool.end());
+    return base;
+}
 
-int Edge::get_from_id()
-{
+/**
+ * @brief Adds an Edge and gives it the next Edge ID
+ *
+ * @param from The From Node
+ * @param to The To Node
+ * @param exploit Index of the Exploit in the exploit table
+ * @param binding Offset of the asset binding returned by add_binding()
+ * @return The new Edge ID
+ */
+int EdgeList::add(int from, int to, size_t exploit, size_t binding) {
+    int id = current_id++;
+    ids.push_back(id);
+    from_nodes.push_back(from);
+    to_nodes.push_back(to);
+    exploits.push_back(static_cast<uint32_t>(exploit));
+    bindings.push_back(static_cast<uint32_t>(binding));
+    return id;
+}
 
-    return from_node;
+/**
+ * @brief Adds an Edge unless the same Edge was already added
+ * @details Two edges are the same if they have the same from node, to node,
+ *          exploit and binding. Only edges added with add_unique() are
+ *          checked.
+ *
+ * @return True if the Edge was added, false if it was a duplicate
+ */
+bool EdgeList::add_unique(int from, int to, size_t exploit, size_t binding) {
+    if ((indexed + 1) * 2 > index_table.size())
+        grow_index();
+
+    size_t mask = index_table.size() - 1;
+    size_t slot = slot_of(from, to, exploit, binding) & mask;
+    while (index_table[slot] != UINT32_MAX) {
+        if (same_edge(index_table[slot], from, to, exploit, binding))
+            return false;
+        slot = (slot + 1) & mask;
+    }
 
+    index_table[slot] = static_cast<uint32_t>(ids.size());
+    indexed++;
+    add(from, to, exploit, binding);
+    return true;
 }
 
-int Edge::get_to_id()
-{
-
-    return to_node;
+size_t EdgeList::slot_of(int from, int to, size_t exploit, size_t binding) const {
+    uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(from)) << 32) | static_cast<uint32_t>(to);
+    h ^= (static_cast<uint64_t>(exploit) << 32 | binding) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 29;
+    return static_cast<size_t>(h);
+}
 
+bool EdgeList::same_edge(size_t i, int from, int to, size_t exploit, size_t binding) const {
+    return from_nodes[i] == from && to_nodes[i] == to && exploits[i] == exploit &&
+           bindings[i] == binding;
 }
 
-int Edge::get_exploit_id()
-{
+/**
+ * @brief Doubles the size of the duplicate index and reinserts its edges
+ */
+void EdgeList::grow_index() {
+    std::vector<uint32_t> old(index_table.size() < 16 ? 32 : index_table.size() * 2, UINT32_MAX);
+    old.swap(index_table);
+
+    size_t mask = index_table.size() - 1;
+    for (auto i : old) {
+        if (i == UINT32_MAX)
+            continue;
+        size_t slot = slot_of(from_nodes[i], to_nodes[i], exploits[i], bindings[i]) & mask;
+        while (index_table[slot] != UINT32_MAX)
+            slot = (slot + 1) & mask;
+        index_table[slot] = i;
+    }
+}
 
-    return exploit.get_id();
+/**
+ * @brief Appends the edges and bindings of another EdgeList, keeping their IDs
+ *
+ * @param other The EdgeList to append
+ */
+void EdgeList::append(const EdgeList &other) {
+    append_edges(other, import_bindings(other));
+}
 
+/**
+ * @brief Appends the edges of another EdgeList, keeping their IDs
+ * @details The other list's bindings are not copied. Its binding offsets are
+ *          shifted by base, so a list whose offsets already point into this
+ *          list's pool is appended with a base of 0.
+ *
+ * @param other The EdgeList whose edges are appended
+ * @param base The amount to add to the other list's binding offsets
+ */
+void EdgeList::append_edges(const EdgeList &other, size_t base) {
+    ids.insert(ids.end(), other.ids.begin(), other.ids.end());
+    from_nodes.insert(from_nodes.end(), other.from_nodes.begin(), other.from_nodes.end());
+    to_nodes.insert(to_nodes.end(), other.to_nodes.begin(), other.to_nodes.end());
+    exploits.insert(exploits.end(), other.exploits.begin(), other.exploits.end());
+    for (auto binding : other.bindings)
+        bindings.push_back(static_cast<uint32_t>(binding + base));
 }
 
 /**
- * @return The Edge information as a string for SQL
+ * @brief Removes edges, keeping the order of the others
+ * @details The duplicate index is rebuilt for the edges left, so add_unique()
+ *          still drops an edge that was kept.
+ *
+ * @param removed Nonzero for every edge to remove, by index
+ * @return The number of edges removed
  */
-std::string Edge::get_query() {
-    return std::to_string(from_node) + "," + std::to_string(to_node) + "," +
-           std::to_string(exploit.get_id()) + ")";
+size_t EdgeList::remove(const std::vector<char> &removed) {
+    // New index of every kept edge, UINT32_MAX for removed ones
+    std::vector<uint32_t> moved(ids.size(), UINT32_MAX);
+    size_t kept = 0;
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (removed[i])
+            continue;
+        ids[kept] = ids[i];
+        from_nodes[kept] = from_nodes[i];
+        to_nodes[kept] = to_nodes[i];
+        exploits[kept] = exploits[i];
+        bindings[kept] = bindings[i];
+        moved[i] = static_cast<uint32_t>(kept++);
+    }
+    size_t count = ids.size() - kept;
+    ids.resize(kept);
+    from_nodes.resize(kept);
+    to_nodes.resize(kept);
+    exploits.resize(kept);
+    bindings.resize(kept);
+
+    if (count > 0 && indexed > 0) {
+        std::vector<uint32_t> old;
+        old.swap(index_table);
+        index_table.assign(old.size(), UINT32_MAX);
+        indexed = 0;
+        size_t mask = index_table.size() - 1;
+        for (auto i : old) {
+            if (i == UINT32_MAX || moved[i] == UINT32_MAX)
+                continue;
+            size_t slot = slot_of(from_nodes[moved[i]], to_nodes[moved[i]], exploits[moved[i]],
+                                  bindings[moved[i]]) & mask;
+            while (index_table[slot] != UINT32_MAX)
+                slot = (slot + 1) & mask;
+            index_table[slot] = moved[i];
+            indexed++;
+        }
+    }
+    return count;
 }
 
 /**
- * @brief Sets the Edge id to the current id and increments edge_current_id.
+ * @brief Gives the edges consecutive IDs
+ * @details For edges whose IDs have to be unique across processes that each
+ *          numbered their own edges, from a range reserved for them.
  *
- * @return The new id
+ * @param first The ID of the first edge
  */
-int Edge::set_id() {
-    id = edge_current_id++;
-    return id;
+void EdgeList::renumber(int first) {
+    for (size_t i = 0; i < ids.size(); i++)
+        ids[i] = first + static_cast<int>(i);
+}
+
+void EdgeList::reserve(size_t n) {
+    ids.reserve(n);
+    from_nodes.reserve(n);
+    to_nodes.reserve(n);
+    exploits.reserve(n);
+    bindings.reserve(n);
 }
 
-int Edge::edge_current_id = 0;
+/**
+ * @param i Index of the Edge
+ * @param exploit_table The exploits the Edge's exploit index refers to
+ * @return The Edge information as a string for SQL
+ */
+std::string EdgeList::get_query(size_t i, const std::vector<Exploit> &exploit_table) const {
+    return std::to_string(from_nodes[i]) + "," + std::to_string(to_nodes[i]) + "," +
+           std::to_string(exploit_table[exploits[i]].get_id()) + ")";
+}
 
 /**
+ * @param i Index of the Edge
+ * @param exploit_table The exploits the Edge's exploit index refers to
  * @return The Assets as a string for SQL
  */
-std::string Edge::get_asset_query() {
-    auto current_perm = assetGroup.get_perm();
+std::string EdgeList::get_asset_query(size_t i, const std::vector<Exploit> &exploit_table) const {
+    size_t num_params = exploit_table[exploits[i]].get_num_params();
+    const size_t *current_perm = get_assets(i);
     std::string sql;
-    for (size_t i = 0; i < current_perm.size(); ++i) {
+    for (size_t j = 0; j < num_params; ++j) {
 
-        if (i == 0)
-            sql += "(" + std::to_string(id) + "," + std::to_string(i) + "," +
-                   std::to_string(current_perm[i]) + ")";
+        if (j == 0)
+            sql += "(" + std::to_string(ids[i]) + "," + std::to_string(j) + "," +
+                   std::to_string(current_perm[j]) + ")";
 
         else
-            sql += ",(" + std::to_string(id) + "," + std::to_string(i) + "," +
-                   std::to_string(current_perm[i]) + ")";
+            sql += ",(" + std::to_string(ids[i]) + "," + std::to_string(j) + "," +
+                   std::to_string(current_perm[j]) + ")";
     }
     return sql;
 }
@@ -5,34 +5,75 @@
 #ifndef AG_GEN_EDGE_H
 #define AG_GEN_EDGE_H
 
-#include "assetgroup.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "exploit.h"
 
-/** Edge class
- * @brief Edge of the graph.
+/** EdgeList class
+ * @brief Edges of the graph.
+ * @details Edges are stored as a struct of arrays: edge ID, from node, to
+ *          node, the index of the exploit in the exploit table and the offset
+ *          of the exploit's asset binding in a shared pool. Bindings are added
+ *          to the pool once and shared by every edge that uses them, so an
+ *          edge costs 20 bytes. The exploit and its assets are only looked up
+ *          again when the edge is exported. Binding offsets are 32 bits, so
+ *          the pool holds at most UINT32_MAX entries; adding past that throws
+ *          std::overflow_error rather than corrupting the offsets.
+ *
+ *          add_unique() drops an edge whose (from, to, exploit, binding) is
+ *          already stored. The set it checks against holds 32-bit edge indices
+ *          and compares against the arrays themselves, so no key is stored
+ *          twice. Only edges added through add_unique() are in the set.
  */
-class Edge {
-    static int edge_current_id;
-    int id;
-    int from_node;
-    int to_node;
-    Exploit exploit;
-    AssetGroup assetGroup;
-    bool deleted;
+class EdgeList {
+    static std::atomic<int> current_id;
+
+    std::vector<int> ids;
+    std::vector<int> from_nodes;
+    std::vector<int> to_nodes;
+    std::vector<uint32_t> exploits;
+    std::vector<uint32_t> bindings;
+
+    std::vector<size_t> binding_pool;
+
+    // Open-addressing set of edge indices used by add_unique()
+    std::vector<uint32_t> index_table;
+    size_t indexed = 0;
+
+    size_t slot_of(int from, int to, size_t exploit, size_t binding) const;
+    bool same_edge(size_t i, int from, int to, size_t exploit, size_t binding) const;
+    void grow_index();
+    void check_pool(size_t added) const;
 
   public:
-    Edge(int, int, Exploit &, AssetGroup &);
-
-    std::string get_query();
-    std::string get_asset_query();
-
-    int get_id();
-    int set_id();
-    int get_from_id();
-    int get_to_id();
-    int get_exploit_id();
-    void set_deleted();
-    bool is_deleted();
+    size_t add_binding(const std::vector<size_t> &perm);
+    size_t import_bindings(const EdgeList &other);
+
+    int add(int from, int to, size_t exploit, size_t binding);
+    bool add_unique(int from, int to, size_t exploit, size_t binding);
+    void append(const EdgeList &other);
+    void append_edges(const EdgeList &other, size_t base = 0);
+    size_t remove(const std::vector<char> &removed);
+    void renumber(int first);
+
+    void reserve(size_t n);
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+
+    int get_id(size_t i) const { return ids[i]; }
+    int get_from_id(size_t i) const { return from_nodes[i]; }
+    int get_to_id(size_t i) const { return to_nodes[i]; }
+    size_t get_exploit(size_t i) const { return exploits[i]; }
+    size_t get_binding(size_t i) const { return bindings[i]; }
+
+    const size_t *get_assets(size_t i) const { return binding_pool.data() + bindings[i]; }
+
+    std::string get_query(size_t i, const std::vector<Exploit> &exploit_table) const;
+    std::string get_asset_query(size_t i, const std::vector<Exploit> &exploit_table) const;
 };
 
 #endif // AG_GEN_EDGE_H
@@ -0,0 +1,156 @@
+// encoding.h defines how qualities and topologies are packed into integers.
+// The width of every field is chosen once per model, from the number of
+// assets and the size of the Keyvalue table.
+
+#ifndef AG_GEN_ENCODING_H
+#define AG_GEN_ENCODING_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief An encoded quality or topology
+ * @details Only the low 64 bits are used when the model fits in them.
+ */
+__extension__ typedef unsigned __int128 Fact;
+
+struct DecodedQuality {
+    int asset_id;
+    int attr;
+    int val;
+};
+
+struct DecodedTopology {
+    int from_asset;
+    int to_asset;
+    int property;
+    int value;
+};
+
+/** FactLayout class
+ * @brief Bit layout of encoded facts
+ * @details A quality is packed as (asset, attribute, value) and a forward
+ *          topology as (from, to, property, value), most significant field
+ *          first. Asset fields are asset_bits wide and Keyvalue fields are
+ *          value_bits wide. The value is always the lowest field, so facts
+ *          that only differ in their value sort next to each other.
+ *
+ *          A layout whose topology fits in 63 bits is stored in one 64-bit
+ *          word per fact, so narrow facts also fit a signed 64-bit integer.
+ *          Larger models use two words per fact.
+ */
+class FactLayout {
+    // Defaults for a model that never chose a layout: one word per fact
+    int asset_bits = 16;
+    int value_bits = 15;
+
+    static int bits_for(size_t count) {
+        int bits = 1;
+        while (bits < 64 && (size_t{1} << bits) < count)
+            bits++;
+        return bits;
+    }
+
+    static Fact mask(int bits) { return (Fact{1} << bits) - 1; }
+
+  public:
+    FactLayout() = default;
+    FactLayout(int asset_bits, int value_bits) : asset_bits(asset_bits), value_bits(value_bits) {}
+
+    /**
+     * @brief Picks the narrowest layout for a model
+     *
+     * @param num_assets The number of assets (one more than the largest ID)
+     * @param num_values The size of the Keyvalue table
+     */
+    static FactLayout choose(size_t num_assets, size_t num_values) {
+        FactLayout layout(bits_for(num_assets), bits_for(num_values));
+        if (layout.total_bits() > 127)
+            throw std::length_error("Model too large to encode facts in 128 bits");
+        return layout;
+    }
+
+    /**
+     * @return True if every asset and Keyvalue ID of a model can be encoded
+     */
+    bool fits(size_t num_assets, size_t num_values) const {
+        return bits_for(num_assets) <= asset_bits && bits_for(num_values) <= value_bits;
+    }
+
+    int get_asset_bits() const { return asset_bits; }
+    int get_value_bits() const { return value_bits; }
+
+    int total_bits() const { return 2 * asset_bits + 2 * value_bits; }
+
+    /**
+     * @return The number of 64-bit words a Factbase uses per fact
+     */
+    size_t words() const { return total_bits() <= 63 ? 1 : 2; }
+
+    Fact quality(int asset_id, int attr, int val) const {
+        return (((Fact(asset_id) << value_bits) | Fact(attr)) << value_bits) | Fact(val);
+    }
+
+    Fact topology(int from_asset, int to_asset, int property, int value) const {
+        Fact f = (Fact(from_asset) << asset_bits) | Fact(to_asset);
+        f = (f << value_bits) | Fact(property);
+        return (f << value_bits) | Fact(value);
+    }
+
+    /**
+     * @return The fact with its value cleared, which identifies what it sets
+     */
+    Fact key(Fact f) const { return f & ~mask(value_bits); }
+
+    /**
+     * @return The Keyvalue ID of the value of a fact
+     */
+    int value(Fact f) const { return int(f & mask(value_bits)); }
+
+    DecodedQuality decode_quality(Fact f) const {
+        DecodedQuality q;
+        q.val = int(f & mask(value_bits));
+        q.attr = int((f >> value_bits) & mask(value_bits));
+        q.asset_id = int(f >> (2 * value_bits));
+        return q;
+    }
+
+    DecodedTopology decode_topology(Fact f) const {
+        DecodedTopology t;
+        t.value = int(f & mask(value_bits));
+        t.property = int((f >> value_bits) & mask(value_bits));
+        t.to_asset = int((f >> (2 * value_bits)) & mask(asset_bits));
+        t.from_asset = int(f >> (2 * value_bits + asset_bits));
+        return t;
+    }
+};
+
+/**
+ * @return The decimal representation of a Fact
+ */
+inline std::string fact_to_string(Fact f) {
+    if (f == 0)
+        return "0";
+    std::string digits;
+    while (f > 0) {
+        digits.insert(digits.begin(), char('0' + int(f % 10)));
+        f /= 10;
+    }
+    return digits;
+}
+
+/**
+ * @brief Parses the decimal representation of a Fact
+ */
+inline Fact parse_fact(const std::string &str) {
+    Fact f = 0;
+    for (char c : str) {
+        if (c < '0' || c > '9')
+            throw std::invalid_argument("Not an encoded fact: " + str);
+        f = f * 10 + Fact(c - '0');
+    }
+    return f;
+}
+
+#endif // AG_GEN_ENCODING_H
@@ -0,0 +1,166 @@
+// estimate.cpp predicts the number of states and edges of an attack graph by
+// expanding a bounded sample of every breadth-first level of it
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "estimate.h"
+
+// Deepest level searched, in case sampling keeps missing a cycle
+static constexpr size_t MAX_LEVELS = 4096;
+
+// Sampled fraction of a level below which the levels after it come out low
+static constexpr double MIN_SAMPLED_FRACTION = 0.1;
+
+// Bytes the generator takes per state in the visited table, at its usual
+// load, and per edge in an EdgeList, including its duplicate index
+static constexpr double VISITED_BYTES = 48;
+static constexpr double EDGE_BYTES = 5 * sizeof(int) + 3 * sizeof(uint32_t);
+
+/**
+ * @brief Estimates the size of an attack graph from a sample of every level
+ * @details The graph is searched breadth first, one level at a time, from the
+ *          initial state. A level of at most samples states is expanded whole
+ *          and counted exactly. Past that, samples states of the level are
+ *          picked at random and expanded, and the size of the next level is
+ *          extrapolated from their successors.
+ *
+ *          Scaling up the successors of a sample overcounts the states that
+ *          several parents lead to. With a fraction q of a level sampled, a
+ *          state with k parents in the level is reached once from the sample
+ *          with probability about k q (1-q)^(k-1), and twice with about
+ *          k(k-1)/2 q^2 (1-q)^(k-2). The numbers f1 and f2 of successors
+ *          reached once and twice therefore give the mean number of parents,
+ *          k = 1 + 2 (1-q) f2 / (q f1), and the next level has the edges into
+ *          it divided by k states. When the number of parents varies between
+ *          states this k is too high, and the sample favours states with many
+ *          parents, so levels far past the sampled fraction are mostly
+ *          underestimated. An underestimated level is sampled at too high a
+ *          fraction, so the error compounds level after level: on a model of
+ *          3.2M states, 1024 samples estimate 0.8M and 16384 2.8M. Bias
+ *          corrected species estimators such as Chao1 come out as low on
+ *          such models. Once a level is sampled at less than
+ *          MIN_SAMPLED_FRACTION, the levels after it and the totals are
+ *          therefore flagged as lower bounds.
+ *
+ *          Random walks that multiply the branching factors along a path, as
+ *          in Knuth's estimator, are not used: they count paths, and an attack
+ *          graph reaches most states through many orderings of the same
+ *          exploits, so it has far more paths than states.
+ *
+ *          Successors seen at an earlier depth are not counted again, but only
+ *          the sampled levels are remembered, so models whose exploits update
+ *          or delete facts may be overestimated. Nothing else is stored and no
+ *          state or edge is written to the database.
+ *
+ * @param instance The model, as it would be passed to AGGen
+ * @param samples States expanded per level
+ * @param seed Seed of the sampling
+ * @return Per-level and total estimates
+ */
+GraphEstimate estimate_graph(const AGGenInstance &instance, size_t samples, unsigned seed) {
+    auto start = std::chrono::system_clock::now();
+    std::mt19937_64 rng(seed);
+    samples = std::max<size_t>(samples, 1);
+    AGGen gen(instance);
+
+    GraphEstimate estimate;
+    std::vector<NetworkState> level;
+    level.emplace_back(instance.initial_qualities, instance.initial_topologies, instance.layout);
+    std::unordered_set<size_t> seen{level.front().get_hash()};
+    double level_states = 1;
+    bool exact = true;
+    double facts = 0; // of all expanded states
+
+    std::vector<NetworkState> children;
+    std::vector<size_t> reached; // times each child was reached
+    std::unordered_map<size_t, size_t> child_index;
+    while (!level.empty() && estimate.levels.size() < MAX_LEVELS) {
+        children.clear();
+        reached.clear();
+        child_index.clear();
+        size_t out_edges = 0;
+        size_t new_edges = 0;
+        for (const auto &state : level) {
+            auto items = state.get_factbase().get_facts_tuple();
+            facts += std::get<0>(items).size() + std::get<1>(items).size();
+            gen.expand(state, [&](size_t, size_t, NetworkState &successor) {
+                out_edges++;
+                size_t hash = successor.get_hash();
+                if (seen.count(hash))
+                    return;
+                new_edges++;
+                auto it = child_index.emplace(hash, children.size());
+                if (it.second) {
+                    children.emplace_back(successor);
+                    reached.push_back(1);
+                } else {
+                    reached[it.first->second]++;
+                }
+            });
+        }
+
+        LevelEstimate current;
+        current.states = level_states;
+        current.sampled = level.size();
+        current.exact = exact;
+        current.lower_bound = estimate.lower_bound;
+        current.branching = static_cast<double>(out_edges) / level.size();
+        current.edges = current.states * current.branching;
+        estimate.levels.push_back(current);
+        estimate.states += current.states;
+        estimate.edges += current.edges;
+        estimate.peak_frontier = std::max(estimate.peak_frontier, current.states);
+
+        double q = level.size() / level_states;
+        estimate.min_fraction = std::min(estimate.min_fraction, q);
+        // The next level is extrapolated from this one, and so on
+        if (!exact && q < MIN_SAMPLED_FRACTION)
+            estimate.lower_bound = true;
+        if (exact || q >= 1) {
+            level_states = children.size();
+        } else if (!children.empty()) {
+            size_t f1 = std::count(reached.begin(), reached.end(), 1);
+            size_t f2 = std::count(reached.begin(), reached.end(), 2);
+            double parents = f1 > 0 ? 1 + 2 * (1 - q) * f2 / (q * f1)
+                                    : static_cast<double>(new_edges) / children.size();
+            level_states = std::max<double>(children.size(), new_edges / q / parents);
+        }
+
+        for (const auto &child : child_index)
+            seen.insert(child.first);
+        level.clear();
+        if (children.size() <= samples) {
+            std::move(children.begin(), children.end(), std::back_inserter(level));
+        } else {
+            // Partial Fisher-Yates shuffle of the child indices
+            exact = false;
+            std::vector<size_t> order(children.size());
+            for (size_t i = 0; i < order.size(); i++)
+                order[i] = i;
+            for (size_t i = 0; i < samples; i++) {
+                std::uniform_int_distribution<size_t> pick(i, order.size() - 1);
+                std::swap(order[i], order[pick(rng)]);
+                level.push_back(std::move(children[order[i]]));
+            }
+        }
+    }
+
+    size_t expanded = 0;
+    for (const auto &lvl : estimate.levels)
+        expanded += lvl.sampled;
+    double mean_facts = expanded > 0 ? facts / expanded : 0;
+    double encoded = mean_facts * instance.layout.words() * sizeof(uint64_t);
+    double state_bytes = sizeof(Factbase) + encoded + sizeof(FactbaseItems) + mean_facts * sizeof(Fact) +
+                         VISITED_BYTES;
+    double frontier_bytes = sizeof(NetworkState) + encoded;
+    estimate.bytes = estimate.states * state_bytes + estimate.edges * EDGE_BYTES +
+                     estimate.peak_frontier * frontier_bytes;
+
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+    estimate.elapsed_seconds = elapsed.count();
+    return estimate;
+}
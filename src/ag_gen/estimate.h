@@ -0,0 +1,40 @@
+// estimate.h declares the state-space estimator, which predicts the size of
+// an attack graph from a sample of its states without generating it
+
+#ifndef AG_GEN_ESTIMATE_H
+#define AG_GEN_ESTIMATE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "ag_gen.h"
+
+/**
+ * @brief Estimated size of one breadth-first level of the graph
+ */
+struct LevelEstimate {
+    double states = 0;    //!< States first reached at this depth
+    double edges = 0;     //!< Edges leaving those states
+    double branching = 0; //!< Mean number of edges leaving a state
+    size_t sampled = 0;   //!< States of the level that were expanded
+    bool exact = false;   //!< Every state of the level was expanded
+    bool lower_bound = false; //!< Extrapolated from too small a sample, likely too low
+};
+
+/**
+ * @brief Estimated size of a whole graph
+ */
+struct GraphEstimate {
+    std::vector<LevelEstimate> levels;
+    double states = 0;
+    double edges = 0;
+    double peak_frontier = 0; //!< States of the largest level
+    double bytes = 0;         //!< Memory the generated graph would take
+    bool lower_bound = false; //!< Some level is a lower bound, and so are the totals
+    double min_fraction = 1;  //!< Smallest fraction of a level that was sampled
+    double elapsed_seconds = 0;
+};
+
+GraphEstimate estimate_graph(const AGGenInstance &instance, size_t samples, unsigned seed = 0);
+
+#endif // AG_GEN_ESTIMATE_H
@@ -28,8 +28,7 @@ void Exploit::print_preconds_t() {
 void Exploit::print_postconds_q() {
     for_each(postconds_q.begin(), postconds_q.end(),
              [](PostconditionQ &q) {
-        auto fact = std::get<1>(q);
-        fact.print();
+        std::get<1>(q).print();
     });
 }
 
@@ -39,8 +38,7 @@ void Exploit::print_postconds_q() {
 void Exploit::print_postconds_t() {
     for_each(postconds_t.begin(), postconds_t.end(),
              [](PostconditionT &q) {
-        auto fact = std::get<1>(q);
-        fact.print();
+        std::get<1>(q).print();
     });
 }
 
@@ -62,8 +60,8 @@ Exploit::Exploit(int preId, string &preName, int preNumParams,
                             std::vector<PostconditionT>>
                      postconds)
     : id(preId), name(preName), num_params(preNumParams),
-      preconds_q(std::get<0>(preconds)), preconds_t(std::get<1>(preconds)),
-      postconds_q(std::get<0>(postconds)), postconds_t(std::get<1>(postconds)) {}
+      preconds_q(std::move(std::get<0>(preconds))), preconds_t(std::move(std::get<1>(preconds))),
+      postconds_q(std::move(std::get<0>(postconds))), postconds_t(std::move(std::get<1>(postconds))) {}
 
 /**
  * @brief Prints the Exploit ID
@@ -73,19 +71,19 @@ void Exploit::print_id() { cout << "Exploit " + to_string(this->id) << endl; }
 /**
  * @brief Gets the ParameterizedQuality preconditions.
  */
-vector<ParameterizedQuality> Exploit::precond_list_q() { return preconds_q; }
+const vector<ParameterizedQuality> &Exploit::precond_list_q() const { return preconds_q; }
 
 /**
  * @brief Gets the ParameterizedTopology preconditions.
  */
-vector<ParameterizedTopology> Exploit::precond_list_t() { return preconds_t; }
+const vector<ParameterizedTopology> &Exploit::precond_list_t() const { return preconds_t; }
 
 /**
  * @brief Gets the ParameterizedQuality postconditions.
  */
-vector<PostconditionQ> Exploit::postcond_list_q() { return postconds_q; }
+const vector<PostconditionQ> &Exploit::postcond_list_q() const { return postconds_q; }
 
 /**
  * @brief Gets the ParameterizedTopology postconditions.
  */
-vector<PostconditionT> Exploit::postcond_list_t() { return postconds_t; }
+const vector<PostconditionT> &Exploit::postcond_list_t() const { return postconds_t; }
@@ -43,7 +43,7 @@ class Exploit {
 
     int get_id() const { return id; }
 
-    std::string get_name() const { return name; }
+    const std::string &get_name() const { return name; }
 
     size_t get_num_params() const { return num_params; }
 
@@ -53,11 +53,11 @@ class Exploit {
     void print_postconds_t();
     void print_id();
 
-    std::vector<ParameterizedQuality> precond_list_q();
-    std::vector<ParameterizedTopology> precond_list_t();
+    const std::vector<ParameterizedQuality> &precond_list_q() const;
+    const std::vector<ParameterizedTopology> &precond_list_t() const;
 
-    std::vector<PostconditionQ> postcond_list_q();
-    std::vector<PostconditionT> postcond_list_t();
+    const std::vector<PostconditionQ> &postcond_list_q() const;
+    const std::vector<PostconditionT> &postcond_list_t() const;
 
     // static std::vector<Exploit> fetch_all();
 
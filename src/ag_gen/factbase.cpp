@@ -3,8 +3,8 @@
 
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <vector>
-#include <set>
 
 #include <boost/functional/hash.hpp>
 
@@ -12,19 +12,167 @@
 
 using namespace std;
 
-int Factbase::current_id = 0;
+std::atomic<int> Factbase::current_id{0};
+
+using FactWords = std::pmr::vector<uint64_t>;
+
+/**
+ * @return The i-th fact of a vector holding w words per fact
+ */
+static Fact load_fact(const FactWords &facts, size_t w, size_t i) {
+    if (w == 1)
+        return facts[i];
+    return (Fact(facts[2 * i]) << 64) | facts[2 * i + 1];
+}
+
+/**
+ * @return The index of the first fact that is not less than fact
+ */
+static size_t lower_bound_fact(const FactWords &facts, size_t w, Fact fact) {
+    size_t lo = 0;
+    size_t hi = facts.size() / w;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (load_fact(facts, w, mid) < fact)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void insert_fact_at(FactWords &facts, size_t w, size_t i, Fact fact) {
+    if (w == 1) {
+        facts.insert(facts.begin() + i, uint64_t(fact));
+    } else {
+        uint64_t words[2] = {uint64_t(fact >> 64), uint64_t(fact)};
+        facts.insert(facts.begin() + 2 * i, words, words + 2);
+    }
+}
+
+/**
+ * @brief Stores encoded facts sorted and without duplicates
+ */
+static void store_facts(FactWords &facts, size_t w, std::vector<Fact> &encoded) {
+    std::sort(encoded.begin(), encoded.end());
+    encoded.erase(std::unique(encoded.begin(), encoded.end()), encoded.end());
+    facts.reserve(encoded.size() * w);
+    for (auto fact : encoded)
+        insert_fact_at(facts, w, facts.size() / w, fact);
+}
+
+static bool contains_fact(const FactWords &facts, size_t w, Fact fact) {
+    size_t i = lower_bound_fact(facts, w, fact);
+    return i < facts.size() / w && load_fact(facts, w, i) == fact;
+}
+
+/**
+ * @brief Checks for a fact with a given key and one of a sorted set of values
+ * @details The facts sharing a key are adjacent, so only they are visited.
+ */
+static bool contains_value(const FactWords &facts, size_t w, Fact key,
+                           const std::vector<int> &values, const FactLayout &layout) {
+    size_t n = facts.size() / w;
+    for (size_t i = lower_bound_fact(facts, w, key); i < n; i++) {
+        Fact fact = load_fact(facts, w, i);
+        if (layout.key(fact) != key)
+            break;
+        if (std::binary_search(values.begin(), values.end(), layout.value(fact)))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Inserts an encoded fact into a sorted vector unless it is present
+ */
+static void insert_fact(FactWords &facts, size_t w, Fact fact) {
+    size_t i = lower_bound_fact(facts, w, fact);
+    if (i == facts.size() / w || load_fact(facts, w, i) != fact)
+        insert_fact_at(facts, w, i, fact);
+}
+
+/**
+ * @brief Removes an encoded fact from a sorted vector if it is present
+ */
+static void erase_fact(FactWords &facts, size_t w, Fact fact) {
+    size_t i = lower_bound_fact(facts, w, fact);
+    if (i < facts.size() / w && load_fact(facts, w, i) == fact)
+        facts.erase(facts.begin() + i * w, facts.begin() + (i + 1) * w);
+}
+
+/**
+ * @brief Replaces the value of every fact with the same key as a given fact
+ * @details The value is the lowest field of a fact, so the facts sharing a
+ *          key are adjacent. Nothing is added if no fact has the key.
+ */
+static void update_fact(FactWords &facts, size_t w, Fact fact, const FactLayout &layout) {
+    Fact key = layout.key(fact);
+    size_t first = lower_bound_fact(facts, w, key);
+    size_t last = first;
+    while (last < facts.size() / w && layout.key(load_fact(facts, w, last)) == key)
+        last++;
+    if (first == last)
+        return;
+    facts.erase(facts.begin() + first * w, facts.begin() + last * w);
+    insert_fact_at(facts, w, first, fact);
+}
 
 /**
  * @brief Constructor for Factbase
  *
  * @param q A vector of Qualities
  * @param t A vector of Topologies
+ * @param layout The fact layout of the model
  */
-Factbase::Factbase(std::vector<Quality> q, std::vector<Topology> t)
-    : qualities(q), topologies(t) {
-    id = 0;
+Factbase::Factbase(const std::vector<Quality> &q, const std::vector<Topology> &t,
+                   const FactLayout &layout)
+    : id(0), layout(layout) {
+    std::vector<Fact> encoded_q;
+    std::vector<Fact> encoded_t;
+    for (const auto &qual : q)
+        encoded_q.push_back(qual.encode(layout));
+    for (const auto &topo : t) {
+        for (auto fact : topo.encode(layout))
+            encoded_t.push_back(fact);
+    }
+    store_facts(qualities, layout.words(), encoded_q);
+    store_facts(topologies, layout.words(), encoded_t);
 }
 
+/**
+ * @brief Constructor for Factbase from already encoded facts
+ *
+ * @param q Encoded Qualities
+ * @param t Encoded Topologies
+ * @param layout The fact layout the facts were encoded with
+ */
+Factbase::Factbase(std::vector<Fact> q, std::vector<Fact> t, const FactLayout &layout)
+    : id(0), layout(layout) {
+    store_facts(qualities, layout.words(), q);
+    store_facts(topologies, layout.words(), t);
+}
+
+/**
+ * @brief Copy constructor for Factbase
+ * @details The copy always uses the default allocator, so copying a Factbase
+ *          out of an Arena yields one that outlives the arena.
+ *
+ * @param fb The Factbase from which to copy
+ */
+Factbase::Factbase(const Factbase &fb)
+    : id(fb.id), depth(fb.depth), layout(fb.layout), qualities(fb.qualities), topologies(fb.topologies) {}
+
+/**
+ * @brief Copy constructor for Factbase using a given memory resource
+ *
+ * @param fb The Factbase from which to copy
+ * @param mr The memory resource for the copy's facts
+ */
+Factbase::Factbase(const Factbase &fb, std::pmr::memory_resource *mr)
+    : id(fb.id), depth(fb.depth), layout(fb.layout), qualities(fb.qualities, mr),
+      topologies(fb.topologies, mr) {}
+
 /**
  * @brief Increments the current ID.
  */
@@ -32,106 +180,122 @@ void Factbase::set_id() {
     id = current_id++;
 }
 
+/**
+ * @brief Sets an ID handed out elsewhere, such as by a shared visited set
+ */
+void Factbase::set_id(int new_id) {
+    id = new_id;
+}
+
 /**
  * @return The current Factbase ID.
  */
 int Factbase::get_id() const { return id; }
 
-std::tuple<std::vector<Quality>, std::vector<Topology>> Factbase::get_facts_tuple() const {
-    return std::make_tuple(qualities, topologies);
+/**
+ * @return The layout the facts are encoded with
+ */
+const FactLayout &Factbase::get_layout() const { return layout; }
+
+/**
+ * @return The encoded Qualities and Topologies of the Factbase
+ */
+std::tuple<std::vector<Fact>, std::vector<Fact>> Factbase::get_facts_tuple() const {
+    size_t w = layout.words();
+    std::vector<Fact> q(qualities.size() / w);
+    std::vector<Fact> t(topologies.size() / w);
+    for (size_t i = 0; i < q.size(); i++)
+        q[i] = load_fact(qualities, w, i);
+    for (size_t i = 0; i < t.size(); i++)
+        t[i] = load_fact(topologies, w, i);
+    return std::make_tuple(std::move(q), std::move(t));
 }
 
 /**
  * @brief Searches for a Quality in the Factbase.
  * @details Returns true if the Quality is found and false otherwise.
  *
- * @param q Quality for which to search.
+ * @param q Encoded Quality for which to search.
  */
-bool Factbase::find_quality(Quality &q) const {
-    return std::find(qualities.begin(), qualities.end(), q) != qualities.end();
-}
-
-std::vector<Quality>::iterator Factbase::get_quality(Quality &q) {
-    return std::find(qualities.begin(), qualities.end(), q);
+bool Factbase::find_quality(Fact q) const {
+    return contains_fact(qualities, layout.words(), q);
 }
 
 /**
  * @brief Searches for a Topology in the Factbase.
  * @details Returns true if the Topology is found and false otherwise.
  *
- * @param t Topology for which to search.
+ * @param t Encoded Topology for which to search.
  */
-bool Factbase::find_topology(Topology &t) const {
-    return std::find(topologies.begin(), topologies.end(), t) != topologies.end();
+bool Factbase::find_topology(Fact t) const {
+    return contains_fact(topologies, layout.words(), t);
 }
 
-std::vector<Topology>::iterator Factbase::get_topology(Topology &t) {
-    return std::find(topologies.begin(), topologies.end(), t);
+/**
+ * @brief Searches for a Quality of an asset and attribute with one of a set
+ *        of values
+ *
+ * @param key Encoded Quality whose value is ignored
+ * @param values Sorted Keyvalue IDs of the accepted values
+ */
+bool Factbase::find_quality_value(Fact key, const std::vector<int> &values) const {
+    return contains_value(qualities, layout.words(), key, values, layout);
 }
 
 /**
- * @brief Adds a given Quality to the factbase's vector of Qualities.
+ * @brief Searches for a Topology between two assets with one of a set of
+ *        values
  *
- * @param q Quality to add
+ * @param key Encoded Topology whose value is ignored
+ * @param values Sorted Keyvalue IDs of the accepted values
  */
-void Factbase::add_quality(Quality &q) {
-    qualities.push_back(q);
+bool Factbase::find_topology_value(Fact key, const std::vector<int> &values) const {
+    return contains_value(topologies, layout.words(), key, values, layout);
 }
 
-void Factbase::delete_quality(Quality &q) {
-    auto qual = get_quality(q);
-    if(qual != qualities.end()) {
-        qualities.erase(qual);
-    }
-}
+/**
+ * @brief Adds an encoded Quality unless it is already known
+ *
+ * @param q Quality to add
+ */
+void Factbase::add_quality(Fact q) { insert_fact(qualities, layout.words(), q); }
 
 /**
- * @brief Adds a given Topology to the factbase's vector of Topologies.
+ * @brief Adds an encoded Topology unless it is already known
  *
  * @param t Topology to add
  */
-void Factbase::add_topology(Topology &t) {
-    topologies.push_back(t);
-}
+void Factbase::add_topology(Fact t) { insert_fact(topologies, layout.words(), t); }
 
-void Factbase::delete_topology(Topology &t) {
-    auto topo = get_topology(t);
-    if(topo != topologies.end()) {
-        topologies.erase(topo);
-    }
-}
+/**
+ * @brief Sets the value of the Quality with the same asset and attribute
+ */
+void Factbase::update_quality(Fact q) { update_fact(qualities, layout.words(), q, layout); }
 
 /**
- * @brief Shamelessly copied from Boost::hash_combine
+ * @brief Sets the value of the Topology with the same assets and property
  */
-// void combine(size_t *seed) {
-//     *seed ^= std::hash<size_t>{}(seed) + 0x9e3779b97f4a7c15 + (seed << 6) +
-//             (seed >> 2);
-// }
+void Factbase::update_topology(Fact t) { update_fact(topologies, layout.words(), t, layout); }
+
+void Factbase::delete_quality(Fact q) { erase_fact(qualities, layout.words(), q); }
+
+void Factbase::delete_topology(Fact t) { erase_fact(topologies, layout.words(), t); }
 
 /**
  * @brief Hashes the Factbase
+ * @details The facts are kept sorted and unique, so the hash does not depend
+ *          on the order in which facts were added. Every word of every fact
+ *          is combined, whatever the width of the layout.
  *
- * @param factlist The current Keyvalue
+ * @param seed Starting value. Hashes with different seeds are independent
+ *             enough to tell apart states whose default hashes collide.
  * @return The hash of the Factbase
  */
-size_t Factbase::hash(Keyvalue &factlist) const {
-    //  size_t hash = 0xf848b64e; // Random seed value
-    // size_t seed = 0x0c32a12fe19d2119;
-    size_t seed = 0;
-
-    std::set<size_t> factset_q;
-    std::transform(qualities.begin(), qualities.end(), std::inserter(factset_q, factset_q.end()),
-        [&](const Quality &q) -> size_t { return q.encode(factlist).enc;});
-    std::for_each(factset_q.begin(), factset_q.end(),
-        [&](size_t t) { boost::hash_combine(seed, t); });
-
-    std::set<size_t> factset_t;
-    std::transform(topologies.begin(), topologies.end(), std::inserter(factset_t, factset_t.end()),
-        [&](const Topology &t) -> size_t { return t.encode(factlist).enc;});
-    std::for_each(factset_t.begin(), factset_t.end(),
-        [&](size_t t) { boost::hash_combine(seed, t); });
-
+size_t Factbase::hash(size_t seed) const {
+    for (auto q : qualities)
+        boost::hash_combine(seed, q);
+    for (auto t : topologies)
+        boost::hash_combine(seed, t);
     return seed;
 }
 
@@ -139,14 +303,16 @@ size_t Factbase::hash(Keyvalue &factlist) const {
  * @brief Prints out the Factbase information.
  */
 void Factbase::print() const {
+    auto facts = get_facts_tuple();
     cout << "ID: " << id << endl;
-//        cout << "HASH: " << hash() << endl;
-    cout << "Qualities: " << qualities.size() << endl;
-    cout << "Topologies: " << topologies.size() << endl << endl;
-    for (auto &qual : qualities) {
-        qual.print();
+    cout << "Qualities: " << std::get<0>(facts).size() << endl;
+    cout << "Topologies: " << std::get<1>(facts).size() << endl << endl;
+    for (auto qual : std::get<0>(facts)) {
+        auto q = layout.decode_quality(qual);
+        cout << q.asset_id << ": " << q.attr << "=" << q.val << endl;
     }
-    for (auto &topo : topologies) {
-        topo.print();
+    for (auto topo : std::get<1>(facts)) {
+        auto t = layout.decode_topology(topo);
+        cout << t.from_asset << " -> " << t.to_asset << ": " << t.property << " " << t.value << endl;
     }
 }
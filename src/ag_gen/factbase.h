@@ -1,10 +1,13 @@
 #ifndef FACTBASE_HPP
 #define FACTBASE_HPP
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <memory_resource>
 #include <vector>
 
+#include "encoding.h"
 #include "quality.h"
 #include "topology.h"
 
@@ -13,39 +16,59 @@ class NetworkState;
 /** Factbase class
  * @brief Contains known facts in a NetworkState.
  * @details Contains known facts that are completely true in the
- *          NetworkState such as Qualities and Topologies.
+ *          NetworkState such as Qualities and Topologies. Facts are kept
+ *          encoded with the model's FactLayout, sorted and without
+ *          duplicates, so looking one up is a binary search over integers.
+ *          Each fact takes one or two 64-bit words, depending on the layout.
  */
 class Factbase {
-    static int current_id;
+    static std::atomic<int> current_id;
 
     int id;
-    std::vector<Quality> qualities;
-    std::vector<Topology> topologies;
+    uint32_t depth = 0; //!< Exploits on the path the state was first reached by
+    FactLayout layout;
+    std::pmr::vector<uint64_t> qualities;
+    std::pmr::vector<uint64_t> topologies;
 
-    Factbase(std::vector<Quality> q, std::vector<Topology> t);
+    Factbase(const std::vector<Quality> &q, const std::vector<Topology> &t,
+             const FactLayout &layout);
+    Factbase(std::vector<Fact> q, std::vector<Fact> t, const FactLayout &layout);
+    Factbase(const Factbase &fb, std::pmr::memory_resource *mr);
 
     friend class NetworkState;
 
   public:
+    Factbase(const Factbase &fb);
+    Factbase(Factbase &&fb) noexcept = default;
 
-    std::tuple<std::vector<Quality>, std::vector<Topology>> get_facts_tuple() const;
+    Factbase &operator=(const Factbase &fb) = default;
+    Factbase &operator=(Factbase &&fb) = default;
 
-    bool find_quality(Quality &q) const;
-    bool find_topology(Topology &t) const;
+    std::tuple<std::vector<Fact>, std::vector<Fact>> get_facts_tuple() const;
+    const FactLayout &get_layout() const;
 
-    std::vector<Quality>::iterator get_quality(Quality &q);
-    std::vector<Topology>::iterator get_topology(Topology &t);
+    bool find_quality(Fact q) const;
+    bool find_topology(Fact t) const;
 
-    void add_quality(Quality &q);
-    void add_topology(Topology &t);
+    bool find_quality_value(Fact key, const std::vector<int> &values) const;
+    bool find_topology_value(Fact key, const std::vector<int> &values) const;
 
-    void delete_quality(Quality &q);
-    void delete_topology(Topology &t);
+    void add_quality(Fact q);
+    void add_topology(Fact t);
+
+    void update_quality(Fact q);
+    void update_topology(Fact t);
+
+    void delete_quality(Fact q);
+    void delete_topology(Fact t);
 
     void print() const;
     void set_id();
+    void set_id(int new_id);
     int get_id() const;
-    size_t hash(Keyvalue &factlist) const;
+    uint32_t get_depth() const { return depth; }
+    void set_depth(uint32_t new_depth) { depth = new_depth; }
+    size_t hash(size_t seed = 0) const;
 };
 
 #endif
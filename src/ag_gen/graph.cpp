@@ -0,0 +1,112 @@
+// graph.cpp builds the compressed-row StateGraph of an attack graph, from a
+// generated instance or from the database, and writes it out for graphviz
+
+#include <algorithm>
+#include <numeric>
+
+#include "graph.h"
+
+#include "util/db_functions.h"
+
+static constexpr uint32_t NO_VERTEX = UINT32_MAX;
+
+/**
+ * @brief Lays out edges by source vertex
+ *
+ * @param ids The IDs of the states
+ * @param num_edges The number of edges
+ * @param edge Returns the edge at an index of the list the graph is built from
+ */
+StateGraph::StateGraph(std::vector<int> ids, size_t num_edges, const std::function<EdgeRow(size_t)> &edge)
+    : state_ids(std::move(ids)) {
+    std::sort(state_ids.begin(), state_ids.end());
+    auto vertex_of = [&](int id) {
+        auto it = std::lower_bound(state_ids.begin(), state_ids.end(), id);
+        return it != state_ids.end() && *it == id ? static_cast<uint32_t>(it - state_ids.begin()) : NO_VERTEX;
+    };
+
+    // Source vertex and ID of every edge, then a counting sort by source
+    std::vector<uint32_t> from(num_edges);
+    std::vector<int> ids_of(num_edges);
+    offsets.assign(state_ids.size() + 1, 0);
+    for (size_t e = 0; e < num_edges; e++) {
+        EdgeRow row = edge(e);
+        ids_of[e] = row[0];
+        from[e] = vertex_of(row[1]);
+        if (from[e] != NO_VERTEX && vertex_of(row[2]) == NO_VERTEX)
+            from[e] = NO_VERTEX;
+        if (from[e] != NO_VERTEX)
+            offsets[from[e] + 1]++;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    sources.resize(offsets.back());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t e = 0; e < num_edges; e++) {
+        if (from[e] != NO_VERTEX)
+            sources[fill[from[e]]++] = static_cast<uint32_t>(e);
+    }
+    // Edges are mostly added in ID order already, so this rarely moves any
+    auto by_id = [&](uint32_t a, uint32_t b) { return ids_of[a] < ids_of[b]; };
+    for (size_t v = 0; v < state_ids.size(); v++) {
+        auto first = sources.begin() + offsets[v], last = sources.begin() + offsets[v + 1];
+        if (!std::is_sorted(first, last, by_id))
+            std::sort(first, last, by_id);
+    }
+
+    targets.resize(sources.size());
+    edge_ids.resize(sources.size());
+    exploit_ids.resize(sources.size());
+    for (size_t slot = 0; slot < sources.size(); slot++) {
+        EdgeRow row = edge(sources[slot]);
+        targets[slot] = vertex_of(row[2]);
+        edge_ids[slot] = row[0];
+        exploit_ids[slot] = row[3];
+    }
+}
+
+/**
+ * @brief Builds the graph of a generated instance straight from its edge list
+ */
+StateGraph::StateGraph(const AGGenInstance &instance)
+    : StateGraph(
+          [&] {
+              std::vector<int> ids;
+              ids.reserve(instance.factbases.size());
+              for (const auto &factbase : instance.factbases)
+                  ids.push_back(factbase.get_id());
+              return ids;
+          }(),
+          instance.edges.size(), [&](size_t e) -> EdgeRow {
+              const EdgeList &edges = instance.edges;
+              return {edges.get_id(e), edges.get_from_id(e), edges.get_to_id(e),
+                      instance.exploits[edges.get_exploit(e)].get_id()};
+          }) {}
+
+/**
+ * @brief Loads the graph stored in the database
+ * @details For tools that work on the results of an earlier run. The
+ *          generator itself builds the graph from its instance.
+ */
+StateGraph StateGraph::load() {
+    GraphInfo info = fetch_graph_info();
+    const auto &rows = info.second;
+    return StateGraph(std::move(info.first), rows.size(), [&](size_t e) { return rows[e]; });
+}
+
+/**
+ * @brief Writes the graph in the graphviz dot format
+ * @details Vertices are named by their number and edges are labelled with
+ *          their exploit ID, as boost::write_graphviz() wrote the graph the
+ *          database was read into.
+ */
+void StateGraph::write_graphviz(std::ostream &out) const {
+    out << "digraph G {\n";
+    for (size_t v = 0; v < num_vertices(); v++)
+        out << v << ";\n";
+    for (size_t v = 0; v < num_vertices(); v++) {
+        for (size_t slot = begin(v); slot < end(v); slot++)
+            out << v << "->" << targets[slot] << " [label=" << exploit_ids[slot] << "];\n";
+    }
+    out << "}\n";
+}
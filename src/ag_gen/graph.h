@@ -0,0 +1,62 @@
+// graph.h declares StateGraph, the compact adjacency of an attack graph that
+// the post-processing stages search and write out
+
+#ifndef AG_GEN_GRAPH_H
+#define AG_GEN_GRAPH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "ag_gen.h"
+
+/** StateGraph class
+ * @brief The states and edges of an attack graph in compressed rows
+ * @details States are numbered 0 to num_vertices() - 1 in the order of their
+ *          IDs. The out edges of vertex v are the slots begin(v) to end(v) of
+ *          a few flat arrays, in the order of their edge IDs, which is the
+ *          order the graph is read from the database in. A slot holds the
+ *          target vertex, the edge ID, the exploit ID and the position of the
+ *          edge in the list the graph was built from, about 16 bytes an edge.
+ *
+ *          The graph is built from a generated AGGenInstance, or from the
+ *          database by a tool that works on stored results. Edges to or from
+ *          a state that is not in the graph are left out.
+ */
+class StateGraph {
+    std::vector<int> state_ids;
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> targets;
+    std::vector<int> edge_ids;
+    std::vector<int> exploit_ids;
+    std::vector<uint32_t> sources; //!< Index of every edge in the list it was built from
+
+    //! Edge ID, from state ID, to state ID and exploit ID of an edge
+    using EdgeRow = std::array<int, 4>;
+
+    StateGraph(std::vector<int> ids, size_t num_edges, const std::function<EdgeRow(size_t)> &edge);
+
+  public:
+    explicit StateGraph(const AGGenInstance &instance);
+
+    static StateGraph load();
+
+    size_t num_vertices() const { return state_ids.size(); }
+    size_t num_edges() const { return targets.size(); }
+
+    size_t begin(size_t v) const { return offsets[v]; }
+    size_t end(size_t v) const { return offsets[v + 1]; }
+
+    int get_state_id(size_t v) const { return state_ids[v]; }
+    uint32_t get_target(size_t slot) const { return targets[slot]; }
+    int get_edge_id(size_t slot) const { return edge_ids[slot]; }
+    int get_exploit_id(size_t slot) const { return exploit_ids[slot]; }
+    size_t get_source(size_t slot) const { return sources[slot]; }
+
+    void write_graphviz(std::ostream &out) const;
+};
+
+#endif // AG_GEN_GRAPH_H
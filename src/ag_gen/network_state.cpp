@@ -14,9 +14,21 @@
  *
  * @param q A vector of Qualities
  * @param t A vector of Topologies
+ * @param layout The fact layout of the model
  */
-NetworkState::NetworkState(std::vector<Quality> q, std::vector<Topology> t)
-    : factbase(Factbase(std::move(q), std::move(t))) {}
+NetworkState::NetworkState(const std::vector<Quality> &q, const std::vector<Topology> &t,
+                           const FactLayout &layout)
+    : factbase(q, t, layout) {}
+
+/**
+ * @brief Constructor for NetworkState from encoded facts
+ *
+ * @param q Encoded Qualities
+ * @param t Encoded Topologies
+ * @param layout The fact layout the facts were encoded with
+ */
+NetworkState::NetworkState(std::vector<Fact> q, std::vector<Fact> t, const FactLayout &layout)
+    : factbase(std::move(q), std::move(t), layout) {}
 
 /**
  * @brief Copy Constructor for NetworkState
@@ -27,15 +39,62 @@ NetworkState::NetworkState(std::vector<Quality> q, std::vector<Topology> t)
  */
 NetworkState::NetworkState(const NetworkState &ns) = default;
 
+/**
+ * @brief Copy Constructor for NetworkState using a given memory resource
+ * @details Used to build candidate successor states in an Arena. Copying
+ *          the result again with the normal copy constructor moves it back
+ *          onto the heap.
+ *
+ * @param ns The NetworkState from which to copy
+ * @param mr The memory resource for the copied Factbase
+ */
+NetworkState::NetworkState(const NetworkState &ns, std::pmr::memory_resource *mr)
+    : factbase(ns.factbase, mr), fired(ns.fired, mr) {}
+
+/**
+ * @brief Records one more exploit on the path to the state
+ * @details Called on a successor, which starts as a copy of its parent. With
+ *          num_exploits set, the times every exploit fired are counted too,
+ *          up to MAX_FIRED.
+ *
+ * @param exploit The exploit that led to the successor
+ * @param num_exploits The number of exploits, 0 to only count the depth
+ */
+void NetworkState::extend_path(size_t exploit, size_t num_exploits) {
+    factbase.set_depth(factbase.get_depth() + 1);
+    if (num_exploits == 0)
+        return;
+    if (fired.size() < num_exploits)
+        fired.resize(num_exploits);
+    if (fired[exploit] < MAX_FIRED)
+        fired[exploit]++;
+}
+
+/**
+ * @brief Restores the path of a state that was sent to another process
+ *
+ * @param depth The depth of the state
+ * @param counts The times every exploit fired, empty if they are not counted
+ */
+void NetworkState::set_path(uint32_t depth, const std::vector<uint16_t> &counts) {
+    factbase.set_depth(depth);
+    fired.assign(counts.begin(), counts.end());
+}
+
 /**
  * @brief Sets the ID of the Factbase
  */
 void NetworkState::set_id() { factbase.set_id(); }
 
+/**
+ * @brief Sets the ID of the Factbase to a given value
+ */
+void NetworkState::set_id(int id) { factbase.set_id(id); }
+
 /**
  * @return The ID of the NetworkState
  */
-int NetworkState::get_id() { return factbase.get_id(); }
+int NetworkState::get_id() const { return factbase.get_id(); }
 
 /**
  * @return The Factbase for the NetworkState
@@ -45,92 +104,23 @@ const Factbase &NetworkState::get_factbase() const { return factbase; }
 /**
  * @brief Returns the hash of the Factbase
  *
- * @param factlist The current Keyvalue
  * @return The hash of the Factbase
  */
-size_t NetworkState::get_hash(Keyvalue &factlist) const {
-    return factbase.hash(factlist);
-}
-
-/**
- * @brief Adds all unique Quality elements of a vector to the Factbase
- *
- * @param q A vector of Qualities
- */
-void NetworkState::add_qualities(std::vector<Quality> q) {
-    // For each quality, check if it already exists in the factbase. If it does
-    // not already exist, we add it.
-    for (auto &qual : q) {
-        add_quality(qual);
-    }
-}
-
-/**
- * @brief Adds all unique Topology elements of a vector to the Factbase
- *
- * @param t A vector of Topologies
- */
-void NetworkState::add_topologies(std::vector<Topology> t) {
-    // For each topology, check if it already exists in the factbase. If it does
-    // not already exist, we add it.
-    for (auto &topo : t) {
-        add_topology(topo);
-    }
+size_t NetworkState::get_hash() const {
+    return factbase.hash();
 }
 
-void NetworkState::add_quality(Quality &q) {
-    if (!factbase.find_quality(q)) {
-        factbase.add_quality(q);
-    }
-}
+void NetworkState::add_quality(Fact q) { factbase.add_quality(q); }
 
-void NetworkState::add_topology(Topology &t) {
-    if (!factbase.find_topology(t)) {
-        factbase.add_topology(t);
-    }
-}
+void NetworkState::add_topology(Fact t) { factbase.add_topology(t); }
 
-void NetworkState::update_quality(Quality &q) {
-    auto asset_id = q.get_asset_id();
-    auto attr = q.get_name();
-    auto val = q.get_value();
-
-    for(auto &qual : factbase.qualities) {
-        if(qual.get_asset_id() == asset_id &&
-            qual.get_name() == attr) {
-            qual.set_value(val);
-        }
-    }
-}
+void NetworkState::update_quality(Fact q) { factbase.update_quality(q); }
 
-void NetworkState::update_topology(Topology &t) {
-    auto from_asset = t.get_from_asset_id();
-    auto to_asset = t.get_to_asset_id();
-    auto attr = t.get_property();
-    auto val = t.get_value();
-
-    for(auto &topo : factbase.topologies) {
-        if(topo.get_from_asset_id() == from_asset &&
-            topo.get_to_asset_id() == to_asset &&
-            topo.get_property() == attr) {
-            topo.set_value(val);
-        }
-    }
-}
+void NetworkState::update_topology(Fact t) { factbase.update_topology(t); }
 
-void NetworkState::delete_quality(Quality &q) {
-    auto qual = factbase.get_quality(q);
-    if(qual != factbase.qualities.end()) {
-        factbase.qualities.erase(qual);
-    }
-}
+void NetworkState::delete_quality(Fact q) { factbase.delete_quality(q); }
 
-void NetworkState::delete_topology(Topology &t) {
-    auto topo = factbase.get_topology(t);
-    if(topo != factbase.topologies.end()) {
-        factbase.topologies.erase(topo);
-    }
-}
+void NetworkState::delete_topology(Fact t) { factbase.delete_topology(t); }
 
 // int NetworkState::compare(std::string &hash, RedisManager* rman) const {
 //     if (!rman->check_collision(hash)) {
@@ -23,29 +23,43 @@ class Network;
  */
 class NetworkState {
     Factbase factbase;
+    std::pmr::vector<uint16_t> fired; //!< Times each exploit fired on the path to the state, if counted
     friend class Factbase;
 
   public:
-    NetworkState(std::vector<Quality> q, std::vector<Topology> t);
+    //! Highest count of an exploit along a path, where the counter stops
+    static constexpr size_t MAX_FIRED = UINT16_MAX;
+
+    NetworkState(const std::vector<Quality> &q, const std::vector<Topology> &t,
+                 const FactLayout &layout);
+    NetworkState(std::vector<Fact> q, std::vector<Fact> t, const FactLayout &layout);
     NetworkState(const NetworkState &ns);
+    NetworkState(const NetworkState &ns, std::pmr::memory_resource *mr);
+    // Keeps the source's allocator: copy, don't move, a state out of an Arena
+    NetworkState(NetworkState &&ns) noexcept = default;
 
     const Factbase &get_factbase() const;
-    size_t get_hash(Keyvalue &factlist) const;
+    size_t get_hash() const;
 
     void set_id();
-    int get_id();
+    void set_id(int id);
+    int get_id() const;
 
-    void add_qualities(std::vector<Quality> q);
-    void add_topologies(std::vector<Topology> t);
+    uint32_t get_depth() const { return factbase.get_depth(); }
+    size_t get_fired(size_t exploit) const { return exploit < fired.size() ? fired[exploit] : 0; }
+    //! Number of exploits whose times fired are counted, 0 if none are
+    size_t counted_exploits() const { return fired.size(); }
+    void extend_path(size_t exploit, size_t num_exploits);
+    void set_path(uint32_t depth, const std::vector<uint16_t> &counts);
 
-    void add_quality(Quality &q);
-    void add_topology(Topology &t);
+    void add_quality(Fact q);
+    void add_topology(Fact t);
 
-    void update_quality(Quality &q);
-    void update_topology(Topology &t);
+    void update_quality(Fact q);
+    void update_topology(Fact t);
 
-    void delete_quality(Quality &q);
-    void delete_topology(Topology &t);
+    void delete_quality(Fact q);
+    void delete_topology(Fact t);
 };
 
 #endif
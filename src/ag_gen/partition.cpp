@@ -0,0 +1,886 @@
+// partition.cpp generates an attack graph with several worker processes that
+// split the states between them by hash. A coordinator relays the states the
+// workers send each other over TCP, detects when the search is done and
+// merges the states and edges of every worker into one instance.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "partition.h"
+
+#include "util/visited_table.h"
+
+// Messages between the coordinator and its workers. Every message is a
+// FrameHeader followed by its payload, in the byte order of the hosts, which
+// therefore have to match (the model fingerprint would differ otherwise).
+typedef enum MESSAGE_T {
+    HELLO_M,   // worker -> coordinator: model fingerprint
+    ASSIGN_M,  // coordinator -> worker: worker index, number of workers and the worker's limits
+    STATES_M,  // worker -> coordinator -> worker dest: a batch of state records
+    IDLE_M,    // worker -> coordinator: out of work, STATES_M frames processed so far
+    DONE_M,    // coordinator -> worker: the search is over
+    RESULTS_M  // worker -> coordinator: the worker's states, edges and unexpanded states
+} MESSAGE_T;
+
+struct FrameHeader {
+    uint32_t type;
+    uint32_t dest;   //!< Worker a STATES_M frame is for
+    uint64_t length; //!< Bytes of payload that follow
+};
+
+// A worker sends a batch once it holds this many bytes of records, and checks
+// for incoming messages after expanding this many states
+static constexpr size_t BATCH_BYTES = size_t{1} << 16;
+static constexpr size_t STATES_PER_POLL = 64;
+
+// How often the coordinator checks on forked workers while they connect
+static constexpr int WORKER_POLL_MS = 200;
+
+/**
+ * @brief Growing byte buffer that messages are serialized into
+ */
+class Buffer {
+    std::vector<char> bytes;
+
+  public:
+    template <typename T>
+    void put(const T &value) {
+        const char *p = reinterpret_cast<const char *>(&value);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+
+    void put_facts(const std::vector<Fact> &facts) {
+        put(static_cast<uint32_t>(facts.size()));
+        for (Fact f : facts)
+            put(f);
+    }
+
+    void put_string(const std::string &str) {
+        put(static_cast<uint32_t>(str.size()));
+        bytes.insert(bytes.end(), str.begin(), str.end());
+    }
+
+    void clear() { bytes.clear(); }
+    size_t size() const { return bytes.size(); }
+    bool empty() const { return bytes.empty(); }
+    const char *data() const { return bytes.data(); }
+};
+
+/**
+ * @brief Reads the values a Buffer was filled with, checking the bounds
+ */
+class Reader {
+    const char *pos;
+    const char *end;
+
+  public:
+    Reader(const char *data, size_t length) : pos(data), end(data + length) {}
+
+    template <typename T>
+    T get() {
+        if (static_cast<size_t>(end - pos) < sizeof(T))
+            throw std::runtime_error("Truncated partition message");
+        T value;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    std::vector<Fact> get_facts() {
+        std::vector<Fact> facts(get<uint32_t>());
+        for (auto &f : facts)
+            f = get<Fact>();
+        return facts;
+    }
+
+    std::string get_string() {
+        auto length = get<uint32_t>();
+        if (static_cast<size_t>(end - pos) < length)
+            throw std::runtime_error("Truncated partition message");
+        std::string str(pos, length);
+        pos += length;
+        return str;
+    }
+
+    bool done() const { return pos == end; }
+};
+
+/**
+ * @return The worker that owns a state hash
+ */
+static uint32_t owner_of(size_t hash, uint32_t workers) {
+    // Multiply first so that every bit of the hash counts
+    return static_cast<uint32_t>((static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ULL >> 32) % workers);
+}
+
+/**
+ * @brief Hashes what the coordinator and its workers have to agree on
+ * @details Workers that load the model from the database on another host
+ *          have to see the same facts, assets, exploits and initial state,
+ *          in the same order, or their fact encodings and asset groups would
+ *          not line up.
+ */
+static uint64_t model_fingerprint(const AGGenInstance &instance) {
+    size_t seed = 0;
+    boost::hash_combine(seed, instance.layout.get_asset_bits());
+    boost::hash_combine(seed, instance.layout.get_value_bits());
+    boost::hash_combine(seed, instance.assets.size());
+    for (const auto &str : instance.facts.get_str_vector())
+        boost::hash_combine(seed, str);
+    for (const auto &ex : instance.exploits) {
+        boost::hash_combine(seed, ex.get_name());
+        boost::hash_combine(seed, ex.get_num_params());
+    }
+    NetworkState root(instance.initial_qualities, instance.initial_topologies, instance.layout);
+    boost::hash_combine(seed, root.get_hash());
+    return seed;
+}
+
+static void write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("Partition send failed: ") + std::strerror(errno));
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+}
+
+static void read_all(int fd, char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = recv(fd, data, length, 0);
+        if (n == 0)
+            throw std::runtime_error("Partition peer closed the connection");
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("Partition receive failed: ") + std::strerror(errno));
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+}
+
+static void send_frame(int fd, MESSAGE_T type, uint32_t dest, const Buffer &payload) {
+    FrameHeader header{static_cast<uint32_t>(type), dest, payload.size()};
+    write_all(fd, reinterpret_cast<const char *>(&header), sizeof(header));
+    write_all(fd, payload.data(), payload.size());
+}
+
+/**
+ * @brief Blocks until a whole frame has arrived
+ * @return The frame type, with its payload in payload
+ */
+static MESSAGE_T read_frame(int fd, std::vector<char> &payload) {
+    FrameHeader header;
+    read_all(fd, reinterpret_cast<char *>(&header), sizeof(header));
+    payload.resize(header.length);
+    read_all(fd, payload.data(), payload.size());
+    return static_cast<MESSAGE_T>(header.type);
+}
+
+static void set_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/**
+ * @brief Opens a listening socket
+ * @param port The port to listen on, on every interface, or 0 to listen on
+ *             an ephemeral port of the loopback interface
+ * @return The socket, with port set to the port it listens on
+ */
+static int listen_on(int &port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Cannot open socket: ") + std::strerror(errno));
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(port == 0 ? INADDR_LOOPBACK : INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    socklen_t len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), len) < 0 || listen(fd, SOMAXCONN) < 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0) {
+        std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error("Cannot listen on port " + std::to_string(port) + ": " + error);
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/**
+ * @param address host:port of the coordinator
+ */
+static int connect_to(const std::string &address) {
+    auto colon = address.rfind(':');
+    if (colon == std::string::npos)
+        throw std::invalid_argument("Coordinator address must be host:port, got " + address);
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *found = nullptr;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &found);
+    if (err != 0)
+        throw std::runtime_error("Cannot resolve " + address + ": " + gai_strerror(err));
+
+    int fd = -1;
+    for (addrinfo *ai = found; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    if (fd < 0)
+        throw std::runtime_error("Cannot connect to coordinator at " + address);
+    set_nodelay(fd);
+    return fd;
+}
+
+/** PartitionWorker class
+ * @brief The search loop of one worker process
+ * @details A worker owns the states whose hash owner_of() maps to its index.
+ *          It keeps the visited table of its own states, expands them and
+ *          sends every successor it does not own to the coordinator, batched
+ *          per owner, as a record of the successor's hash, its parent's ID,
+ *          the exploit and asset group that produced it and its facts. The
+ *          owner of a successor records the edge to it, so every edge is
+ *          stored exactly once.
+ *
+ *          A worker remembers the hashes of the states it has forwarded.
+ *          When the same successor turns up again, from another parent or
+ *          another asset group, only its hash and the edge are sent. The
+ *          owner has its facts by then, since the coordinator relays a
+ *          worker's batches in order.
+ *
+ *          The i-th state of worker w gets the ID i * workers + w, which is
+ *          unique over all workers without any coordination. The
+ *          coordinator renumbers the states densely once the search is done.
+ *
+ *          Before each round of STATES_PER_POLL expansions a worker checks
+ *          its share of the run's limits. Once they are exceeded it stops
+ *          expanding and behaves as if it were out of work, still recording
+ *          the states and edges it is sent, and reports the states it did
+ *          not expand with its results.
+ */
+class PartitionWorker {
+    struct Edge {
+        int from;
+        int to;
+        uint32_t exploit;
+        uint32_t group;
+    };
+
+    int fd;
+    uint32_t index = 0;
+    uint32_t workers = 1;
+    GenerationLimits limits;
+    AGGen gen;
+    FactLayout layout;
+
+    VisitedTable visited;
+    VisitedTable forwarded;                       //!< Hashes of the states sent to other workers
+    std::vector<Factbase> states;                 //!< By local position
+    std::deque<std::pair<int, NetworkState>> queue; //!< Owned states left to expand, with their IDs
+    std::vector<Edge> edges;
+    std::vector<Buffer> outgoing;                 //!< Records not sent yet, per owner
+    uint64_t processed = 0;                       //!< STATES_M frames received
+
+    void flush(uint32_t owner) {
+        if (outgoing[owner].empty())
+            return;
+        send_frame(fd, STATES_M, owner, outgoing[owner]);
+        outgoing[owner].clear();
+    }
+
+    /**
+     * @brief Records a state this worker owns, and the edge to it
+     * @param state A state with the default allocator
+     */
+    void receive(size_t hash, int from, uint32_t exploit, uint32_t group, NetworkState &&state) {
+        auto entry = visited.insert_or_get(hash, [&] {
+            return static_cast<int>(states.size() * workers + index);
+        });
+        if (entry.second) {
+            states.push_back(state.get_factbase());
+            queue.emplace_back(entry.first, std::move(state));
+        }
+        if (from >= 0)
+            edges.push_back({from, entry.first, exploit, group});
+    }
+
+    void receive_records(const std::vector<char> &payload) {
+        Reader in(payload.data(), payload.size());
+        while (!in.done()) {
+            auto hash = in.get<uint64_t>();
+            auto from = in.get<int32_t>();
+            auto exploit = in.get<uint32_t>();
+            auto group = in.get<uint32_t>();
+            if (!in.get<uint8_t>()) {
+                // A state that was forwarded with its facts before
+                int to = visited.find(hash);
+                if (to < 0)
+                    throw std::runtime_error("Partition worker got an edge to an unknown state");
+                edges.push_back({from, to, exploit, group});
+                continue;
+            }
+            auto quals = in.get_facts();
+            auto topos = in.get_facts();
+            receive(hash, from, exploit, group, NetworkState(std::move(quals), std::move(topos), layout));
+        }
+    }
+
+    void expand(int id, const NetworkState &state) {
+        gen.expand(state, [&](size_t exploit, size_t group, NetworkState &successor) {
+            auto hash = successor.get_hash();
+            uint32_t owner = owner_of(hash, workers);
+            if (owner == index) {
+                receive(hash, id, exploit, group, NetworkState(successor));
+                return;
+            }
+            Buffer &out = outgoing[owner];
+            out.put(static_cast<uint64_t>(hash));
+            out.put(static_cast<int32_t>(id));
+            out.put(static_cast<uint32_t>(exploit));
+            out.put(static_cast<uint32_t>(group));
+            bool first = forwarded.insert_or_get(hash, [] { return 0; }).second;
+            out.put(static_cast<uint8_t>(first));
+            if (first) {
+                auto facts = successor.get_factbase().get_facts_tuple();
+                out.put_facts(std::get<0>(facts));
+                out.put_facts(std::get<1>(facts));
+            }
+            if (out.size() >= BATCH_BYTES)
+                flush(owner);
+        });
+    }
+
+    bool readable() const {
+        pollfd p{fd, POLLIN, 0};
+        return poll(&p, 1, 0) > 0;
+    }
+
+    void send_results(const Budget &budget) {
+        Buffer out;
+        out.put(static_cast<uint64_t>(states.size()));
+        for (const auto &fb : states) {
+            auto facts = fb.get_facts_tuple();
+            out.put_facts(std::get<0>(facts));
+            out.put_facts(std::get<1>(facts));
+        }
+        out.put(static_cast<uint64_t>(edges.size()));
+        for (const auto &e : edges) {
+            const auto &perm = gen.get_perm(e.exploit, e.group);
+            out.put(static_cast<int32_t>(e.from));
+            out.put(static_cast<int32_t>(e.to));
+            out.put(e.exploit);
+            out.put(static_cast<uint32_t>(perm.size()));
+            for (size_t asset : perm)
+                out.put(static_cast<uint64_t>(asset));
+        }
+        out.put(static_cast<uint64_t>(queue.size()));
+        for (const auto &entry : queue)
+            out.put(static_cast<int32_t>(entry.first));
+        out.put_string(budget.stopped() ? budget.get_reason() : "");
+        send_frame(fd, RESULTS_M, 0, out);
+    }
+
+  public:
+    PartitionWorker(int fd, const AGGenInstance &instance)
+        : fd(fd), gen(instance), layout(instance.layout) {}
+
+    void run(uint64_t fingerprint) {
+        Buffer hello;
+        hello.put(fingerprint);
+        send_frame(fd, HELLO_M, 0, hello);
+
+        std::vector<char> payload;
+        if (read_frame(fd, payload) != ASSIGN_M)
+            throw std::runtime_error("Coordinator did not accept this worker");
+        Reader assign(payload.data(), payload.size());
+        index = assign.get<uint32_t>();
+        workers = assign.get<uint32_t>();
+        limits.max_states = assign.get<uint64_t>();
+        limits.max_edges = assign.get<uint64_t>();
+        limits.max_rss = assign.get<uint64_t>();
+        limits.max_seconds = assign.get<double>();
+        outgoing.resize(workers);
+
+        Budget budget(limits);
+        bool idle_sent = false;
+        while (true) {
+            // Out of work or over budget: send everything on, say so once, then wait
+            bool wait = queue.empty() || budget.exceeded(states.size(), edges.size());
+            if (wait) {
+                for (uint32_t w = 0; w < workers; w++)
+                    flush(w);
+                if (!idle_sent) {
+                    Buffer idle;
+                    idle.put(processed);
+                    send_frame(fd, IDLE_M, 0, idle);
+                    idle_sent = true;
+                }
+            }
+            if (wait || readable()) {
+                MESSAGE_T type = read_frame(fd, payload);
+                if (type == DONE_M) {
+                    send_results(budget);
+                    return;
+                }
+                if (type != STATES_M)
+                    throw std::runtime_error("Unexpected message from coordinator");
+                receive_records(payload);
+                processed++;
+                idle_sent = false;
+                continue;
+            }
+
+            for (size_t s = 0; s < STATES_PER_POLL && !queue.empty(); s++) {
+                auto current = std::move(queue.front());
+                queue.pop_front();
+                expand(current.first, current.second);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Runs a worker of a partitioned run until its coordinator is done
+ * @details The instance has to be the model the coordinator was started
+ *          with, loaded the same way; the coordinator rejects the worker
+ *          otherwise.
+ *
+ * @param instance The model, without any generated states
+ * @param coordinator host:port of the coordinator
+ */
+void run_partition_worker(const AGGenInstance &instance, const std::string &coordinator) {
+    int fd = connect_to(coordinator);
+    try {
+        PartitionWorker worker(fd, instance);
+        worker.run(model_fingerprint(instance));
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+/**
+ * @brief The coordinator's side of a worker connection
+ * @details The coordinator never blocks on a worker: sockets are non-blocking
+ *          and both directions are buffered, so two workers sending each
+ *          other large batches cannot deadlock through it.
+ */
+struct Connection {
+    int fd = -1;
+    std::vector<char> in;     //!< Received bytes not handled yet
+    std::vector<char> out;    //!< Bytes not sent yet, from out_pos on
+    size_t out_pos = 0;
+    uint64_t relayed = 0;     //!< STATES_M frames queued for the worker
+    uint64_t processed = 0;   //!< STATES_M frames it had handled when it last went idle
+    bool idle = false;        //!< Its last message was IDLE_M
+    bool finished = false;    //!< Its results arrived
+    std::vector<char> results;
+
+    void queue_frame(MESSAGE_T type, uint32_t dest, const char *payload, size_t length) {
+        FrameHeader header{static_cast<uint32_t>(type), dest, length};
+        const char *h = reinterpret_cast<const char *>(&header);
+        out.insert(out.end(), h, h + sizeof(header));
+        out.insert(out.end(), payload, payload + length);
+    }
+};
+
+/**
+ * @brief Merges the states and edges the workers sent back
+ * @details States are renumbered densely, the initial state first and then
+ *          in the order of the IDs the workers gave them. Asset bindings are
+ *          added to the edge binding pool once each. The run stopped at the
+ *          first limit a worker reports.
+ */
+static void merge_results(AGGenInstance &merged, std::vector<Connection> &conns, int root) {
+    uint32_t workers = static_cast<uint32_t>(conns.size());
+    std::vector<std::vector<NetworkState>> states(workers);
+    size_t most = 0;
+    for (uint32_t w = 0; w < workers; w++) {
+        Reader in(conns[w].results.data(), conns[w].results.size());
+        auto n = in.get<uint64_t>();
+        states[w].reserve(n);
+        for (uint64_t i = 0; i < n; i++) {
+            auto quals = in.get_facts();
+            auto topos = in.get_facts();
+            states[w].emplace_back(std::move(quals), std::move(topos), merged.layout);
+        }
+        most = std::max(most, states[w].size());
+    }
+
+    std::vector<std::vector<int>> dense(workers);
+    for (uint32_t w = 0; w < workers; w++)
+        dense[w].assign(states[w].size(), -1);
+    auto add_state = [&](uint32_t w, size_t i) {
+        NetworkState &state = states[w][i];
+        state.set_id();
+        dense[w][i] = state.get_id();
+        merged.factbase_items.emplace_back(state.get_factbase().get_facts_tuple(), state.get_id());
+        merged.factbases.push_back(state.get_factbase());
+    };
+    add_state(root % workers, root / workers);
+    for (size_t i = 0; i < most; i++) {
+        for (uint32_t w = 0; w < workers; w++) {
+            if (i < states[w].size() && dense[w][i] < 0)
+                add_state(w, i);
+        }
+    }
+    auto to_dense = [&](int id) {
+        uint32_t w = id % workers;
+        size_t i = id / workers;
+        if (id < 0 || i >= dense[w].size())
+            throw std::runtime_error("Partition worker sent an edge to an unknown state");
+        return dense[w][i];
+    };
+
+    std::map<std::vector<size_t>, size_t> bindings;
+    std::vector<size_t> perm;
+    for (uint32_t w = 0; w < workers; w++) {
+        Reader in(conns[w].results.data(), conns[w].results.size());
+        auto n = in.get<uint64_t>();
+        for (uint64_t i = 0; i < n; i++) {
+            in.get_facts();
+            in.get_facts();
+        }
+        auto num_edges = in.get<uint64_t>();
+        for (uint64_t e = 0; e < num_edges; e++) {
+            int from = to_dense(in.get<int32_t>());
+            int to = to_dense(in.get<int32_t>());
+            auto exploit = in.get<uint32_t>();
+            perm.resize(in.get<uint32_t>());
+            for (auto &asset : perm)
+                asset = in.get<uint64_t>();
+            if (exploit >= merged.exploits.size())
+                throw std::runtime_error("Partition worker sent an edge for an unknown exploit");
+            auto it = bindings.find(perm);
+            if (it == bindings.end())
+                it = bindings.emplace(perm, merged.edges.add_binding(perm)).first;
+            merged.edges.add(from, to, exploit, it->second);
+        }
+        auto num_unexpanded = in.get<uint64_t>();
+        for (uint64_t u = 0; u < num_unexpanded; u++)
+            merged.unexpanded.push_back(to_dense(in.get<int32_t>()));
+        auto reason = in.get_string();
+        if (merged.stop_reason.empty())
+            merged.stop_reason = reason;
+        std::vector<char>().swap(conns[w].results);
+    }
+}
+
+/**
+ * @brief Waits for the next worker to connect
+ * @details Forked workers that exit before connecting would leave the
+ *          coordinator waiting forever, so while waiting it checks on them
+ *          every WORKER_POLL_MS.
+ *
+ * @param children The forked workers, empty for workers on other hosts
+ * @return The worker's socket
+ */
+static int accept_worker(int listener, std::vector<pid_t> &children) {
+    while (true) {
+        pollfd listening{listener, POLLIN, 0};
+        int ready = poll(&listening, 1, children.empty() ? -1 : WORKER_POLL_MS);
+        if (ready < 0 && errno != EINTR)
+            throw std::runtime_error(std::string("Partition poll failed: ") + std::strerror(errno));
+        if (ready > 0) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0)
+                return fd;
+            if (errno != EINTR && errno != ECONNABORTED)
+                throw std::runtime_error(std::string("Cannot accept a worker: ") + std::strerror(errno));
+        }
+        for (auto it = children.begin(); it != children.end(); ++it) {
+            int status = 0;
+            if (waitpid(*it, &status, WNOHANG) == *it) {
+                children.erase(it);
+                throw std::runtime_error("A partition worker exited before connecting");
+            }
+        }
+    }
+}
+
+/**
+ * @brief Kills and reaps the forked workers of a failed run
+ */
+static void stop_workers(std::vector<pid_t> &children) {
+    for (pid_t pid : children)
+        kill(pid, SIGKILL);
+    for (pid_t pid : children)
+        waitpid(pid, nullptr, 0);
+    children.clear();
+}
+
+/**
+ * @brief Relays states between the connected workers until the search is over
+ * @details See generate_partitioned.
+ *
+ * @return The worker that owns the initial state
+ */
+static uint32_t coordinate(const AGGenInstance &instance, std::vector<Connection> &conns) {
+    int workers = static_cast<int>(conns.size());
+
+    // The initial state goes to its owner, which numbers it first
+    NetworkState root(instance.initial_qualities, instance.initial_topologies, instance.layout);
+    uint32_t root_owner = owner_of(root.get_hash(), workers);
+    {
+        Buffer record;
+        record.put(static_cast<uint64_t>(root.get_hash()));
+        record.put(int32_t{-1});
+        record.put(uint32_t{0});
+        record.put(uint32_t{0});
+        record.put(uint8_t{1});
+        auto facts = root.get_factbase().get_facts_tuple();
+        record.put_facts(std::get<0>(facts));
+        record.put_facts(std::get<1>(facts));
+        conns[root_owner].queue_frame(STATES_M, root_owner, record.data(), record.size());
+        conns[root_owner].relayed++;
+    }
+
+    std::vector<pollfd> polls(workers);
+    size_t finished = 0;
+    bool done_sent = false;
+    char chunk[1 << 16];
+    while (finished < conns.size()) {
+        if (!done_sent && std::all_of(conns.begin(), conns.end(), [](const Connection &c) {
+                return c.idle && c.processed == c.relayed;
+            })) {
+            for (auto &c : conns)
+                c.queue_frame(DONE_M, 0, nullptr, 0);
+            done_sent = true;
+        }
+
+        for (int w = 0; w < workers; w++) {
+            polls[w].fd = conns[w].finished ? -1 : conns[w].fd;
+            polls[w].events = POLLIN | (conns[w].out_pos < conns[w].out.size() ? POLLOUT : 0);
+            polls[w].revents = 0;
+        }
+        if (poll(polls.data(), polls.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("Partition poll failed: ") + std::strerror(errno));
+        }
+
+        for (int w = 0; w < workers; w++) {
+            Connection &c = conns[w];
+            if (polls[w].revents & POLLOUT) {
+                ssize_t n = send(c.fd, c.out.data() + c.out_pos, c.out.size() - c.out_pos, MSG_NOSIGNAL);
+                if (n < 0 && errno != EAGAIN && errno != EINTR)
+                    throw std::runtime_error("Lost the connection to worker " + std::to_string(w));
+                c.out_pos += std::max<ssize_t>(n, 0);
+                if (c.out_pos == c.out.size()) {
+                    c.out.clear();
+                    c.out_pos = 0;
+                } else if (c.out_pos >= BATCH_BYTES * 16) {
+                    c.out.erase(c.out.begin(), c.out.begin() + c.out_pos);
+                    c.out_pos = 0;
+                }
+            }
+            if (!(polls[w].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+
+            ssize_t n;
+            while ((n = recv(c.fd, chunk, sizeof(chunk), 0)) > 0)
+                c.in.insert(c.in.end(), chunk, chunk + n);
+            // A worker closes its end right after sending its results
+            bool closed = n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR);
+
+            size_t pos = 0;
+            while (c.in.size() - pos >= sizeof(FrameHeader)) {
+                FrameHeader header;
+                std::memcpy(&header, c.in.data() + pos, sizeof(header));
+                if (c.in.size() - pos - sizeof(header) < header.length)
+                    break;
+                const char *body = c.in.data() + pos + sizeof(header);
+                switch (header.type) {
+                case STATES_M:
+                    if (header.dest >= conns.size())
+                        throw std::runtime_error("Worker " + std::to_string(w) + " sent states to an unknown worker");
+                    conns[header.dest].queue_frame(STATES_M, header.dest, body, header.length);
+                    conns[header.dest].relayed++;
+                    c.idle = false;
+                    break;
+                case IDLE_M:
+                    c.processed = Reader(body, header.length).get<uint64_t>();
+                    c.idle = true;
+                    break;
+                case RESULTS_M:
+                    c.results.assign(body, body + header.length);
+                    c.finished = true;
+                    finished++;
+                    break;
+                default:
+                    throw std::runtime_error("Unexpected message from worker " + std::to_string(w));
+                }
+                pos += sizeof(header) + header.length;
+            }
+            c.in.erase(c.in.begin(), c.in.begin() + pos);
+            if (closed && !c.finished)
+                throw std::runtime_error("Lost the connection to worker " + std::to_string(w));
+        }
+    }
+    return root_owner;
+}
+
+/**
+ * @brief Generates an attack graph with several worker processes
+ * @details Each worker owns the states whose hash maps to it and expands them
+ *          (see PartitionWorker). Workers send the successors they do not own
+ *          to the coordinator, which relays them to their owners.
+ *
+ *          The coordinator counts the batches it relays to each worker, and
+ *          a worker that runs out of work reports how many batches it has
+ *          handled. The search is over once every worker's last message says
+ *          it is idle and has handled every batch relayed to it: no worker
+ *          has work then, and none is in flight. The coordinator then asks
+ *          every worker for its states and edges and merges them.
+ *
+ *          With port 0 the workers are forked from this process and connect
+ *          over the loopback interface. Otherwise the coordinator listens on
+ *          every interface and waits for the workers to connect, typically
+ *          ag_gen processes started with -W on other hosts.
+ *
+ *          Every worker gets an equal share of the state, edge and memory
+ *          limits and the whole time limit, since each one checks them on
+ *          its own. Workers keep recording the states they are sent once
+ *          they stop, so a small limit can be overshot by the states still in
+ *          flight. Path bounds are not supported, as the states the workers
+ *          send each other do not carry their paths. Forked workers
+ *          are killed if the run fails.
+ *
+ * @param instance The model, without any generated states
+ * @param workers The number of worker processes
+ * @param port The port to listen on, or 0 to fork local workers
+ * @param limits When to stop early
+ * @return The generated instance
+ */
+AGGenInstance generate_partitioned(const AGGenInstance &instance, int workers, int port,
+                                   const GenerationLimits &limits) {
+    if (workers < 1)
+        throw std::invalid_argument("A partitioned run needs at least one worker");
+    auto start = std::chrono::system_clock::now();
+    bool local = port == 0;
+    int listener = listen_on(port);
+
+    std::vector<pid_t> children;
+    std::vector<Connection> conns(workers);
+    uint32_t root_owner = 0;
+    try {
+        if (local) {
+            std::cout << std::flush;
+            std::string address = "127.0.0.1:" + std::to_string(port);
+            for (int w = 0; w < workers; w++) {
+                pid_t pid = fork();
+                if (pid < 0)
+                    throw std::runtime_error(std::string("Cannot fork a worker: ") + std::strerror(errno));
+                if (pid == 0) {
+                    // Leave the parent's database connection and buffers alone
+                    close(listener);
+                    int status = EXIT_SUCCESS;
+                    try {
+                        run_partition_worker(instance, address);
+                    } catch (const std::exception &e) {
+                        std::cerr << "Partition worker: " << e.what() << std::endl;
+                        status = EXIT_FAILURE;
+                    } catch (...) {
+                        status = EXIT_FAILURE;
+                    }
+                    _exit(status);
+                }
+                children.push_back(pid);
+            }
+        } else {
+            std::cout << "Waiting for " << workers << " workers on port " << port << std::endl;
+        }
+
+        uint64_t fingerprint = model_fingerprint(instance);
+        auto share = [&](size_t limit) { return (limit + workers - 1) / workers; };
+        std::vector<char> payload;
+        for (int w = 0; w < workers; w++) {
+            int fd = accept_worker(listener, children);
+            set_nodelay(fd);
+            conns[w].fd = fd;
+            if (read_frame(fd, payload) != HELLO_M ||
+                Reader(payload.data(), payload.size()).get<uint64_t>() != fingerprint)
+                throw std::runtime_error("A worker loaded a different model");
+            Buffer assign;
+            assign.put(static_cast<uint32_t>(w));
+            assign.put(static_cast<uint32_t>(workers));
+            assign.put(static_cast<uint64_t>(share(limits.max_states)));
+            assign.put(static_cast<uint64_t>(share(limits.max_edges)));
+            assign.put(static_cast<uint64_t>(share(limits.max_rss)));
+            assign.put(limits.max_seconds);
+            send_frame(fd, ASSIGN_M, 0, assign);
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+        close(listener);
+        listener = -1;
+
+        root_owner = coordinate(instance, conns);
+    } catch (...) {
+        if (listener >= 0)
+            close(listener);
+        for (auto &c : conns) {
+            if (c.fd >= 0)
+                close(c.fd);
+        }
+        stop_workers(children);
+        throw;
+    }
+    for (auto &c : conns)
+        close(c.fd);
+
+    bool failed = false;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+    }
+    if (failed)
+        throw std::runtime_error("A partition worker failed");
+
+    AGGenInstance merged = instance;
+    merged.factbases.clear();
+    merged.factbase_items.clear();
+    merged.edges = EdgeList();
+    merge_results(merged, conns, static_cast<int>(root_owner));
+
+    merged.elapsed_seconds = std::chrono::system_clock::now() - start;
+    return merged;
+}
@@ -0,0 +1,16 @@
+// partition.h declares multi-process generation, in which every worker
+// process owns the states whose hash maps to it
+
+#ifndef AG_GEN_PARTITION_H
+#define AG_GEN_PARTITION_H
+
+#include <string>
+
+#include "ag_gen.h"
+
+AGGenInstance generate_partitioned(const AGGenInstance &instance, int workers, int port = 0,
+                                   const GenerationLimits &limits = GenerationLimits());
+
+void run_partition_worker(const AGGenInstance &instance, const std::string &coordinator);
+
+#endif // AG_GEN_PARTITION_H
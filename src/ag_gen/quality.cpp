@@ -11,30 +11,23 @@
  * @param o The operation
  * @param qualValue The value of the Quality
  */
-Quality::Quality(int asset, std::string qualName, std::string o, std::string qualValue, Keyvalue &facts)
-    : asset_id(asset), name(std::move(qualName)), op(std::move(o)), value(std::move(qualValue)), encoded(encode(facts).enc) {}
+Quality::Quality(int asset, std::string qualName, std::string o, std::string qualValue, const Keyvalue &facts)
+    : asset_id(asset), name(std::move(qualName)), op(std::move(o)), value(std::move(qualValue)),
+      attr_id(facts[name]), value_id(facts[value]) {}
 
 int Quality::get_asset_id() const { return asset_id; }
 
 /**
  * @return The name of the Quality
  */
-std::string Quality::get_name() const { return name; }
+const std::string &Quality::get_name() const { return name; }
 
 /**
  * @return The operation
  */
-std::string Quality::get_op() const { return op; }
+const std::string &Quality::get_op() const { return op; }
 
-std::string Quality::get_value() const { return value; }
-
-const size_t Quality::get_encoding() const {
-    return encoded;
-}
-
-void Quality::set_value(std::string &val) {
-    value = val;
-}
+const std::string &Quality::get_value() const { return value; }
 
 /**
  * @brief Prints the Quality
@@ -47,17 +40,12 @@ void Quality::print() const {
 /**
  * @brief Encodes the Quality
  *
- * @param kv_facts The Keyvalue of the facts
+ * @param layout The fact layout of the model
  *
- * @return The EncodedQuality
+ * @return The encoded Quality
  */
-EncodedQuality Quality::encode(const Keyvalue &kv_facts) const {
-    EncodedQuality qual{};
-    qual.dec.asset_id = asset_id;
-    qual.dec.attr = kv_facts[name];
-    qual.dec.val = kv_facts[value];
-
-    return qual;
+Fact Quality::encode(const FactLayout &layout) const {
+    return layout.quality(asset_id, attr_id, value_id);
 }
 
 bool Quality::operator==(const Quality &rhs) const {
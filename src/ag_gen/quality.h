@@ -7,17 +7,9 @@
 
 #include <string>
 
-#include "util/keyvalue.h"
+#include "encoding.h"
 
-union EncodedQuality {
-    struct {
-        int asset_id : 16;
-        int attr : 12;
-        int op : 4;
-        int val : 16;
-    } dec;
-    size_t enc;
-};
+#include "util/keyvalue.h"
 
 /**
  * @brief Holds information about a Quality and a parameter number.
@@ -26,8 +18,9 @@ struct ParameterizedQuality {
     int param;
     std::string name;
     std::string value;
+    std::string op; //!< Comparison of a precondition, empty means equality
 
-    int get_param_num() { return param; }
+    int get_param_num() const { return param; }
 
     void print() {
         std::cout << "Param: " + std::to_string(param) << std::endl;
@@ -47,24 +40,19 @@ class Quality {
     std::string op;
     std::string value;
 
-    size_t encoded;
-
-    EncodedQuality encode(const Keyvalue &kv_facts) const;
-
-    friend class Factbase;
+    int attr_id;  //!< Keyvalue ID of the name
+    int value_id; //!< Keyvalue ID of the value
 
   public:
     Quality(int assetId, std::string qualName, std::string op,
-            std::string qualValue, Keyvalue &facts);
+            std::string qualValue, const Keyvalue &facts);
 
     int get_asset_id() const;
-    std::string get_name() const;
-    std::string get_op() const;
-    std::string get_value() const;
-
-    const size_t get_encoding() const;
+    const std::string &get_name() const;
+    const std::string &get_op() const;
+    const std::string &get_value() const;
 
-    void set_value(std::string &val);
+    Fact encode(const FactLayout &layout) const;
 
     void print() const;
 
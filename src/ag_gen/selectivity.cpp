@@ -0,0 +1,126 @@
+// selectivity.cpp keeps the hit and miss counters of exploit preconditions
+// and derives the order in which the matcher checks them
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "selectivity.h"
+
+/**
+ * @brief Sets up empty counters and the file order for every exploit
+ */
+Selectivity::Selectivity(const std::vector<Exploit> &exploits) {
+    for (const auto &ex : exploits) {
+        size_t n = count_preconditions(ex);
+        names.push_back(ex.get_name());
+        counters.emplace_back(n);
+        orders.emplace_back(n);
+        std::iota(orders.back().begin(), orders.back().end(), 0);
+    }
+}
+
+/**
+ * @return The number of grounded preconditions of each AssetGroup of an
+ *         exploit
+ */
+size_t Selectivity::count_preconditions(const Exploit &ex) {
+    size_t n = ex.precond_list_q().size();
+    for (const auto &precond : ex.precond_list_t())
+        n += precond.get_dir() == BIDIRECTION_T ? 2 : 1;
+    return n;
+}
+
+/**
+ * @brief Sorts every exploit's preconditions by how often they held
+ * @details The pass rate is smoothed, so a precondition that was never
+ *          checked sorts as if it held half of the time. Ties keep the
+ *          previous order.
+ */
+void Selectivity::reorder() {
+    checks = 0;
+    for (size_t i = 0; i < orders.size(); i++) {
+        const auto &counter = counters[i];
+        auto rate = [&](uint32_t k) {
+            return (counter[k].passed + 1.0) / (counter[k].tested + 2.0);
+        };
+        std::stable_sort(orders[i].begin(), orders[i].end(),
+                         [&](uint32_t a, uint32_t b) { return rate(a) < rate(b); });
+    }
+}
+
+/**
+ * @brief Adds what a worker's copy counted since it was made
+ *
+ * @param worker A copy of base that a worker counted into
+ * @param base The Selectivity the worker's copy was made from
+ */
+void Selectivity::merge(const Selectivity &worker, const Selectivity &base) {
+    for (size_t i = 0; i < counters.size(); i++) {
+        for (size_t k = 0; k < counters[i].size(); k++) {
+            counters[i][k].tested += worker.counters[i][k].tested - base.counters[i][k].tested;
+            counters[i][k].passed += worker.counters[i][k].passed - base.counters[i][k].passed;
+        }
+    }
+    reorder();
+}
+
+/**
+ * @brief Adds the counters of an earlier run and reorders
+ * @details Each line of a stats file holds an exploit name, the position of
+ *          a precondition, how often it was checked and how often it held.
+ *          Lines for exploits or preconditions that this model does not
+ *          have are skipped, so a stats file from an older version of the
+ *          exploit patterns can still be used.
+ *
+ * @param path The file written by save()
+ */
+void Selectivity::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot read precondition stats from " + path);
+
+    std::unordered_map<std::string, size_t> by_name;
+    for (size_t i = 0; i < names.size(); i++)
+        by_name.emplace(names[i], i);
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string name;
+        size_t precond;
+        Counter counter;
+        if (!(fields >> name >> precond >> counter.tested >> counter.passed))
+            throw std::runtime_error("Malformed precondition stats line: " + line);
+
+        auto it = by_name.find(name);
+        if (it == by_name.end() || precond >= counters[it->second].size())
+            continue;
+        auto &c = counters[it->second][precond];
+        c.tested += counter.tested;
+        c.passed += std::min(counter.passed, counter.tested);
+    }
+    reorder();
+}
+
+/**
+ * @brief Writes every precondition's counters to a stats file
+ */
+void Selectivity::save(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("Cannot write precondition stats to " + path);
+
+    out << "# exploit\tprecondition\ttested\tpassed\n";
+    for (size_t i = 0; i < names.size(); i++) {
+        for (size_t k = 0; k < counters[i].size(); k++) {
+            out << names[i] << '\t' << k << '\t' << counters[i][k].tested << '\t'
+                << counters[i][k].passed << '\n';
+        }
+    }
+}
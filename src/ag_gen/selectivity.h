@@ -0,0 +1,69 @@
+#ifndef AG_GEN_SELECTIVITY_H
+#define AG_GEN_SELECTIVITY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "exploit.h"
+
+/** Selectivity class
+ * @brief Hit and miss counters of every exploit's preconditions
+ * @details Preconditions are numbered the way every AssetGroup of the exploit
+ *          lists them: qualities first, then topologies, in file order, with
+ *          a bidirectional topology taking two positions. The matcher checks
+ *          them in the exploit's current order and records the outcome of
+ *          each check it makes. reorder() then sorts every exploit's
+ *          preconditions by how often they held, so the precondition most
+ *          likely to fail is checked first, whether it is a quality or a
+ *          topology.
+ *
+ *          The counters can be saved after a run and loaded before the next
+ *          one, so generation starts with the order the earlier run learned.
+ *          Parallel workers each count into their own copy, and the copies are
+ *          merged once generation is done.
+ */
+class Selectivity {
+  public:
+    struct Counter {
+        uint64_t tested = 0;
+        uint64_t passed = 0;
+    };
+
+  private:
+    std::vector<std::string> names;                //!< Exploit names, for stats files
+    std::vector<std::vector<Counter>> counters;    //!< Per exploit, per precondition
+    std::vector<std::vector<uint32_t>> orders;     //!< Per exploit, check order
+    uint64_t checks = 0;                           //!< Checks since the last reorder
+
+  public:
+    //! Number of checks between two reorders
+    static constexpr uint64_t REORDER_INTERVAL = uint64_t{1} << 16;
+
+    Selectivity() = default;
+    explicit Selectivity(const std::vector<Exploit> &exploits);
+
+    static size_t count_preconditions(const Exploit &ex);
+
+    const std::vector<uint32_t> &get_order(size_t exploit) const { return orders[exploit]; }
+
+    Counter *get_counters(size_t exploit) { return counters[exploit].data(); }
+
+    /**
+     * @brief Reorders the preconditions once enough checks were recorded
+     * @param made The number of checks made since the last call
+     */
+    void tick(uint64_t made) {
+        checks += made;
+        if (checks >= REORDER_INTERVAL)
+            reorder();
+    }
+
+    void reorder();
+    void merge(const Selectivity &worker, const Selectivity &base);
+
+    void load(const std::string &path);
+    void save(const std::string &path) const;
+};
+
+#endif // AG_GEN_SELECTIVITY_H
@@ -0,0 +1,270 @@
+// simulate.cpp runs random walks from the initial network state, each one an
+// attacker that fires a random applicable exploit at every step, and counts
+// how often and how quickly the walks reach goal facts
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/functional/hash.hpp>
+
+#include "simulate.h"
+
+#include "util/thread_pool.h"
+
+// Walks run as one task, with their own random numbers, so the results do
+// not depend on the number of threads
+static constexpr size_t WALKS_PER_TASK = 256;
+
+// Distinct exploit sequences a worker counts; the walks of any sequence
+// beyond that are only counted as untracked
+static constexpr size_t MAX_SEQUENCES = size_t{1} << 16;
+
+struct SequenceHash {
+    size_t operator()(const std::vector<uint32_t> &sequence) const {
+        return boost::hash_range(sequence.begin(), sequence.end());
+    }
+};
+
+/**
+ * @brief Counters of one simulation worker, added up once all walks are done
+ */
+struct Walker {
+    MatchScratch scratch;
+    std::vector<size_t> lengths;
+    std::vector<size_t> goal_hits;
+    std::vector<double> goal_steps;
+    size_t cut_off = 0;
+    size_t reached_any = 0;
+    std::unordered_map<std::vector<uint32_t>, size_t, SequenceHash> sequences;
+    size_t untracked = 0;
+
+    std::vector<uint32_t> sequence;
+    std::vector<char> reached;
+};
+
+/**
+ * @brief Reads exploit weights for simulate_walks()
+ * @details Every line of the file holds an exploit name and its weight.
+ *          Exploits that are not listed weigh 1, and lines starting with #
+ *          are skipped.
+ *
+ * @return The weight of every exploit, in the order of exploits
+ */
+std::vector<double> load_exploit_weights(const std::string &path, const std::vector<Exploit> &exploits) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot read exploit weights from " + path);
+
+    std::unordered_map<std::string, size_t> by_name;
+    for (size_t i = 0; i < exploits.size(); i++)
+        by_name.emplace(exploits[i].get_name(), i);
+
+    std::vector<double> weights(exploits.size(), 1.0);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string name;
+        double weight;
+        if (!(fields >> name >> weight) || weight < 0)
+            throw std::runtime_error("Malformed exploit weight line: " + line);
+        auto it = by_name.find(name);
+        if (it == by_name.end())
+            throw std::runtime_error("Unknown exploit in weights: " + name);
+        weights[it->second] = weight;
+    }
+    return weights;
+}
+
+/**
+ * @brief Moves a walk one step forward
+ * @details Picks one of the matched asset groups, uniformly or by the weight
+ *          of its exploit, and applies it. A group that leaves the state as it
+ *          was is dropped and another one is picked.
+ *
+ * @return The exploit that fired, or -1 if no group changes the state
+ */
+static long step_walk(const AGGen &gen, const std::vector<double> &weights, NetworkState &state,
+                      std::vector<std::pair<size_t, size_t>> &candidates, std::mt19937_64 &rng) {
+    size_t hash = state.get_hash();
+    while (!candidates.empty()) {
+        size_t pick;
+        if (weights.empty()) {
+            pick = std::uniform_int_distribution<size_t>(0, candidates.size() - 1)(rng);
+        } else {
+            double total = 0;
+            for (const auto &cand : candidates)
+                total += weights[cand.first];
+            if (total <= 0)
+                return -1;
+            double x = std::uniform_real_distribution<double>(0, total)(rng);
+            for (pick = 0; pick + 1 < candidates.size(); pick++) {
+                x -= weights[candidates[pick].first];
+                if (x < 0)
+                    break;
+            }
+        }
+
+        auto chosen = candidates[pick];
+        gen.apply(chosen.first, chosen.second, state);
+        if (state.get_hash() != hash)
+            return static_cast<long>(chosen.first);
+        candidates[pick] = candidates.back();
+        candidates.pop_back();
+    }
+    return -1;
+}
+
+/**
+ * @brief Runs one walk from the initial state and counts its outcome
+ */
+static void run_walk(const AGGen &gen, const NetworkState &root, const SimulationOptions &options,
+                     Walker &w, std::mt19937_64 &rng) {
+    NetworkState state(root);
+    const auto &goals = options.goals;
+    w.sequence.clear();
+    w.reached.assign(goals.size(), 0);
+    size_t first_goal = 0;
+    bool any = false;
+
+    auto check_goals = [&](size_t steps) {
+        for (size_t g = 0; g < goals.size(); g++) {
+            if (w.reached[g] || !state.get_factbase().find_quality(goals[g]))
+                continue;
+            w.reached[g] = 1;
+            w.goal_hits[g]++;
+            w.goal_steps[g] += steps;
+            if (!any) {
+                any = true;
+                first_goal = steps;
+            }
+        }
+    };
+
+    size_t steps = 0;
+    check_goals(0);
+    while (true) {
+        if (steps == options.max_steps) {
+            w.cut_off++;
+            break;
+        }
+        gen.match(state, w.scratch);
+        long exploit = step_walk(gen, options.weights, state, w.scratch.applicable, rng);
+        if (exploit < 0)
+            break;
+        w.sequence.push_back(static_cast<uint32_t>(exploit));
+        check_goals(++steps);
+    }
+
+    if (w.lengths.size() <= steps)
+        w.lengths.resize(steps + 1);
+    w.lengths[steps]++;
+
+    if (!goals.empty()) {
+        if (!any)
+            return;
+        w.reached_any++;
+        w.sequence.resize(first_goal);
+    }
+    auto it = w.sequences.find(w.sequence);
+    if (it != w.sequences.end())
+        it->second++;
+    else if (w.sequences.size() < MAX_SEQUENCES)
+        w.sequences.emplace(w.sequence, 1);
+    else
+        w.untracked++;
+}
+
+/**
+ * @brief Simulates random attackers instead of generating the whole graph
+ * @details Every walk starts at the initial state and, at each step, matches
+ *          the state with the grounded exploits and fires one applicable
+ *          exploit binding at random, uniformly or by the weight of its
+ *          exploit. A walk ends when nothing it can fire changes the state, or
+ *          after max_steps steps. Walks keep no record of the states they
+ *          visit, so memory does not grow with the number of walks.
+ *
+ *          Walks run on numThrd threads, in tasks of WALKS_PER_TASK walks that
+ *          each seed their own generator from the seed and the task number,
+ *          so the results are the same for any number of threads. Only the
+ *          choice of exploit sequences that are counted once a worker tracks
+ *          MAX_SEQUENCES of them depends on timing.
+ *
+ * @param instance The model, as it would be passed to AGGen
+ * @param options Number of walks, goals and exploit weights
+ * @param numThrd Number of threads
+ * @return Goal frequencies, walk lengths and the most frequent sequences
+ */
+SimulationResult simulate_walks(const AGGenInstance &instance, const SimulationOptions &options,
+                                int numThrd) {
+    auto start = std::chrono::system_clock::now();
+    if (!options.weights.empty() && options.weights.size() != instance.exploits.size())
+        throw std::invalid_argument("Expected one weight per exploit");
+
+    AGGen gen(instance);
+    NetworkState root(instance.initial_qualities, instance.initial_topologies, instance.layout);
+    ThreadPool pool(std::max(numThrd, 1));
+    std::vector<Walker> walkers(pool.size());
+    for (auto &w : walkers) {
+        w.scratch = gen.make_scratch();
+        w.goal_hits.assign(options.goals.size(), 0);
+        w.goal_steps.assign(options.goals.size(), 0);
+    }
+
+    size_t tasks = (options.walks + WALKS_PER_TASK - 1) / WALKS_PER_TASK;
+    pool.run(tasks, [&](size_t task, size_t worker) {
+        std::seed_seq seeds{static_cast<uint64_t>(options.seed), static_cast<uint64_t>(task)};
+        std::mt19937_64 rng(seeds);
+        size_t end = std::min(options.walks, (task + 1) * WALKS_PER_TASK);
+        for (size_t i = task * WALKS_PER_TASK; i < end; i++)
+            run_walk(gen, root, options, walkers[worker], rng);
+    });
+
+    SimulationResult result;
+    result.walks = options.walks;
+    result.goal_hits.assign(options.goals.size(), 0);
+    result.goal_steps.assign(options.goals.size(), 0);
+    std::unordered_map<std::vector<uint32_t>, size_t, SequenceHash> sequences;
+    for (auto &w : walkers) {
+        result.cut_off += w.cut_off;
+        result.reached_any += w.reached_any;
+        result.untracked += w.untracked;
+        for (size_t g = 0; g < options.goals.size(); g++) {
+            result.goal_hits[g] += w.goal_hits[g];
+            result.goal_steps[g] += w.goal_steps[g];
+        }
+        if (result.lengths.size() < w.lengths.size())
+            result.lengths.resize(w.lengths.size());
+        for (size_t len = 0; len < w.lengths.size(); len++)
+            result.lengths[len] += w.lengths[len];
+        for (auto &seq : w.sequences)
+            sequences[seq.first] += seq.second;
+    }
+    for (size_t g = 0; g < options.goals.size(); g++) {
+        if (result.goal_hits[g] > 0)
+            result.goal_steps[g] /= result.goal_hits[g];
+    }
+
+    // Most walks first, then shortest and lowest exploit numbers first
+    result.sequences.assign(sequences.begin(), sequences.end());
+    size_t top = std::min(options.top_sequences, result.sequences.size());
+    std::partial_sort(result.sequences.begin(), result.sequences.begin() + top, result.sequences.end(),
+                      [](const auto &a, const auto &b) {
+                          if (a.second != b.second)
+                              return a.second > b.second;
+                          if (a.first.size() != b.first.size())
+                              return a.first.size() < b.first.size();
+                          return a.first < b.first;
+                      });
+    result.sequences.resize(top);
+
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+    result.elapsed_seconds = elapsed.count();
+    return result;
+}
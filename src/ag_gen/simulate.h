@@ -0,0 +1,44 @@
+// simulate.h declares the Monte Carlo attack simulation, which estimates how
+// often random attackers reach goal facts without generating the graph
+
+#ifndef AG_GEN_SIMULATE_H
+#define AG_GEN_SIMULATE_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ag_gen.h"
+
+struct SimulationOptions {
+    size_t walks = 0;
+    size_t max_steps = 1000;     //!< Steps after which a walk is cut off
+    std::vector<Fact> goals;     //!< Qualities whose first appearance in a walk is counted
+    std::vector<double> weights; //!< Per exploit, empty to pick every binding alike
+    size_t top_sequences = 10;   //!< Exploit sequences to report
+    unsigned seed = 0;
+};
+
+struct SimulationResult {
+    size_t walks = 0;
+    size_t cut_off = 0;             //!< Walks that reached max_steps
+    size_t reached_any = 0;         //!< Walks that reached at least one goal
+    std::vector<size_t> goal_hits;  //!< Walks that reached each goal
+    std::vector<double> goal_steps; //!< Mean steps to each goal, over the walks that reached it
+    std::vector<size_t> lengths;    //!< Number of walks of every length
+
+    //! Most frequent exploit sequences, up to the first goal if there are
+    //! goals, and the number of walks that took them
+    std::vector<std::pair<std::vector<uint32_t>, size_t>> sequences;
+    size_t untracked = 0; //!< Walks whose sequence was not counted
+
+    double elapsed_seconds = 0;
+};
+
+std::vector<double> load_exploit_weights(const std::string &path, const std::vector<Exploit> &exploits);
+
+SimulationResult simulate_walks(const AGGenInstance &instance, const SimulationOptions &options,
+                                int numThrd);
+
+#endif // AG_GEN_SIMULATE_H
@@ -14,9 +14,10 @@
  * @param val The value of the Topology
  */
 Topology::Topology(int f_asset, int t_asset, DIRECTION_T dir, std::string property,
-                   std::string op, std::string val, Keyvalue &facts)
+                   std::string op, std::string val, const Keyvalue &facts)
     : from_asset_id(f_asset), to_asset_id(t_asset), property(move(property)),
-      op(move(op)), value(move(val)), dir(std::move(dir)), encoded(encode(facts).enc) {}
+      op(move(op)), value(move(val)), dir(std::move(dir)),
+      property_id(facts[this->property]), value_id(facts[value]) {}
 
 /**
  * @return The From Asset ID
@@ -31,23 +32,48 @@ int Topology::get_to_asset_id() const { return to_asset_id; }
 /**
  * @return The property of the Topology
  */
-std::string Topology::get_property() const { return property; }
+const std::string &Topology::get_property() const { return property; }
 
 /**
  * @return The operation of the Topology
  */
-std::string Topology::get_op() const { return op; }
+const std::string &Topology::get_op() const { return op; }
 
-const size_t Topology::get_encoding() const {
-    return encoded;
+/**
+ * @brief Encodes the Topology as it is stored in a Factbase
+ * @details See encode_facts().
+ *
+ * @param layout The fact layout of the model
+ * @return One or two encoded facts
+ */
+std::vector<Fact> Topology::encode(const FactLayout &layout) const {
+    std::vector<Fact> facts;
+    encode_facts(layout, from_asset_id, to_asset_id, dir, property_id, value_id, facts);
+    return facts;
+}
+
+/**
+ * @brief Encodes a Topology the way a Factbase stores it
+ * @details A Factbase only holds forward topologies, so that a fact has a
+ *          single encoding no matter how it was written. A backward topology
+ *          is stored as the reversed forward one and a bidirectional topology
+ *          as both forward ones. The property and value are Keyvalue IDs.
+ *
+ * @param out The vector the encoded facts are appended to
+ */
+void Topology::encode_facts(const FactLayout &layout, int from_asset, int to_asset,
+                            DIRECTION_T dir, int property, int value, std::vector<Fact> &out) {
+    if (dir != BACKWARD_T)
+        out.push_back(layout.topology(from_asset, to_asset, property, value));
+    if (dir == BACKWARD_T || (dir == BIDIRECTION_T && from_asset != to_asset))
+        out.push_back(layout.topology(to_asset, from_asset, property, value));
 }
 
 /**
  * @return The value of the Topology
  */
-std::string Topology::get_value() const { return value; }
+const std::string &Topology::get_value() const { return value; }
 
-void Topology::set_value(std::string &val) { value = val; }
 
 /**
  * @return The direction of the Topology
@@ -64,29 +90,12 @@ void Topology::print() const {
          << std::endl;
 }
 
-/**
- * @brief Encodes the Topology
- *
- * @param kv_facts The Keyvalue of the facts
- *
- * @return The EncodedTopology
- */
-const EncodedTopology Topology::encode(const Keyvalue &kv_facts) const {
-    EncodedTopology topo{};
-
-    topo.dec.from_asset = from_asset_id;
-    topo.dec.to_asset = to_asset_id;
-    topo.dec.dir = dir;
-    topo.dec.property = kv_facts[property];
-    topo.dec.op = 0; // Assuming only one operation for now
-    topo.dec.value = kv_facts[value];
-
-    return topo;
-}
-
 bool Topology::operator==(const Topology &rhs) const {
     if(this->dir != BIDIRECTION_T) {
-        return (this->from_asset_id == rhs.from_asset_id) || (this->to_asset_id == rhs.to_asset_id);
+        if (this->dir != rhs.dir || this->from_asset_id != rhs.from_asset_id ||
+            this->to_asset_id != rhs.to_asset_id) {
+            return false;
+        }
     } else {
         if(this->from_asset_id != rhs.from_asset_id && this->from_asset_id != rhs.to_asset_id) {
             return false;
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "encoding.h"
+
 #include "util/keyvalue.h"
 
 typedef enum {
@@ -12,19 +14,6 @@ typedef enum {
     BIDIRECTION_T = 2,
 } DIRECTION_T;
 
-union EncodedTopology {
-    struct {
-        int from_asset : 16;
-        int to_asset : 16;
-        int dir : 2;
-        int property : 10;
-        int op : 4;
-        int value : 16;
-
-    } dec;
-    size_t enc;
-};
-
 struct ParameterizedTopology {
     int from_param;
     int to_param;
@@ -33,12 +22,12 @@ struct ParameterizedTopology {
     std::string op;
     std::string val;
 
-    int get_from_param() { return from_param; }
-    int get_to_param() { return to_param; }
-    DIRECTION_T get_dir() { return dir; }
-    std::string get_property() { return prop; }
-    std::string get_operation() { return op; }
-    std::string get_value() { return val; }
+    int get_from_param() const { return from_param; }
+    int get_to_param() const { return to_param; }
+    DIRECTION_T get_dir() const { return dir; }
+    const std::string &get_property() const { return prop; }
+    const std::string &get_operation() const { return op; }
+    const std::string &get_value() const { return val; }
 
     void print() {
         std::cout << "From Param: " << std::to_string(from_param) << std::endl;
@@ -63,31 +52,29 @@ class Topology {
     std::string value;
     DIRECTION_T dir;
 
-    size_t encoded;
-
-    const EncodedTopology encode(const Keyvalue &kv_facts) const;
-
-    friend class Factbase;
+    int property_id; //!< Keyvalue ID of the property
+    int value_id;    //!< Keyvalue ID of the value
 
   public:
     Topology(int f_asset, int t_asset, DIRECTION_T dir, std::string property,
-             std::string op, std::string val, Keyvalue &facts);
+             std::string op, std::string val, const Keyvalue &facts);
 
     int get_from_asset_id() const;
     int get_to_asset_id() const;
-    std::string get_property() const;
-    std::string get_op() const;
-    std::string get_value() const;
+    const std::string &get_property() const;
+    const std::string &get_op() const;
+    const std::string &get_value() const;
     DIRECTION_T get_dir() const;
 
-    const size_t get_encoding() const;
+    std::vector<Fact> encode(const FactLayout &layout) const;
+
+    static void encode_facts(const FactLayout &layout, int from_asset, int to_asset,
+                             DIRECTION_T dir, int property, int value, std::vector<Fact> &out);
 
     void print() const;
 
     bool operator==(const Topology &rhs) const;
     bool operator<(const Topology &rhs) const;
-
-    void set_value(std::string &val);
 };
 
 #endif // AG_GEN_TOPOLOGY_H
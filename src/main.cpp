@@ -4,25 +4,32 @@
 //!
 
 #include <algorithm>
+#include <chrono>
 #include <getopt.h>
 #include <iostream>
+#include <memory>
 #include <fstream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <unordered_map>
+#include <cctype>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <sys/stat.h>
 #include <sys/time.h>
 
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/properties.hpp>
-#include <boost/graph/graphviz.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
-#include <boost/graph/visitors.hpp>
-#include <boost/graph/depth_first_search.hpp>
 
 #include "ag_gen/ag_gen.h"
+#include "ag_gen/component.h"
+#include "ag_gen/cycles.h"
+#include "ag_gen/estimate.h"
+#include "ag_gen/graph.h"
+#include "ag_gen/partition.h"
+#include "ag_gen/simulate.h"
 #include "util/db_functions.h"
 #include "util/build_sql.h"
 #include "util/db.h"
@@ -34,94 +41,6 @@
 #include "util/redis_manager.h"
 #endif // REDIS
 
-template<typename GraphEdge>
-class ag_visitor : public boost::default_dfs_visitor {
-    std::vector<std::pair<GraphEdge, int>> &to_delete;
-  public:
-    explicit ag_visitor(std::vector<std::pair<GraphEdge, int>> &_to_delete) : to_delete(_to_delete) {}
-
-    template <typename Graph>
-    void back_edge(GraphEdge e, Graph g) {
-        typename boost::property_map<Graph, boost::edge_index_t>::type Edge_Index =
-                            boost::get(boost::edge_index, g);
-
-        int index = Edge_Index[e];
-        // edges[index].set_deleted();
-        to_delete.push_back(std::make_pair(e, index));
-    }
-};
-
-typedef boost::property<boost::edge_name_t, std::string,
-    boost::property<boost::edge_index_t, int>> EdgeProperties;
-typedef boost::property<boost::vertex_name_t, int> VertexNameProperty;
-
-typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS,
-    VertexNameProperty, EdgeProperties> Graph;
-
-typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
-typedef boost::graph_traits<Graph>::edge_descriptor GraphEdge;
-
-Graph graph_init() {
-    GraphInfo info = fetch_graph_info();
-
-    auto factbase_ids = info.first;
-    auto edges = info.second;
-
-    Graph g;
-
-    boost::property_map<Graph, boost::vertex_name_t>::type Factbase_ID = boost::get(boost::vertex_name, g);
-    boost::property_map<Graph, boost::edge_name_t>::type Exploit_ID = boost::get(boost::edge_name, g);
-    boost::property_map<Graph, boost::edge_index_t>::type Edge_Index = boost::get(boost::edge_index, g);
-
-    std::unordered_map<int, Vertex> vertex_map;
-
-    for (int fid : factbase_ids) {
-        Vertex v = boost::add_vertex(g);
-        Factbase_ID[v] = fid;
-        vertex_map[fid] = v;
-    }
-
-    for (auto ei : edges) {
-        int eid = ei[0];
-        int from_id = ei[1];
-        int to_id = ei[2];
-        int exid = ei[3];
-
-        Vertex from_v = vertex_map[from_id];
-        Vertex to_v = vertex_map[to_id];
-
-        GraphEdge e = boost::add_edge(from_v, to_v, g).first;
-        Exploit_ID[e] = std::to_string(exid);
-        Edge_Index[e] = eid;
-    }
-
-    return g;
-}
-
-void remove_cycles(Graph &g) {
-    std::vector<std::pair<GraphEdge, int>> to_delete;
-
-    // ag_visitor<GraphEdge> vis(edges, to_delete);
-    ag_visitor<GraphEdge> vis(to_delete);
-    boost::depth_first_search(g, boost::visitor(vis));
-
-    std::vector<int> delete_edge_ids;
-    delete_edge_ids.resize(to_delete.size());
-
-    for (int i = 0; i < to_delete.size(); ++i) {
-        boost::remove_edge(to_delete[i].first, g);
-        delete_edge_ids[i] = to_delete[i].second;
-    }
-
-    delete_edges(delete_edge_ids);
-}
-
-void graph_ag(Graph &g, std::string &filename) {
-    std::ofstream gout;
-    gout.open(filename);
-    boost::write_graphviz(gout, g, boost::default_writer(), boost::make_label_writer(boost::get(boost::edge_name, g)));
-}
-
 extern "C" {
     extern FILE *nmin;
     extern int nmparse(networkmodel *nm);
@@ -344,20 +263,106 @@ std::string parse_xp(std::string &filename) {
     return output;
 }
 
+// States expanded per level by --estimate without an argument
+static constexpr size_t ESTIMATE_SAMPLES = 1024;
+
 /**
  * @brief      Prints command line usage information.
  */
 void print_usage() {
-    std::cout << "Usage: ag_gen [OPTION...]" << std::endl << std::endl;
+    std::cout << "Usage: ag_gen [OPTION...] thread_count init_qsize" << std::endl << std::endl;
     std::cout << "Flags:" << std::endl;
     std::cout << "\t-c\tConfig section in config.ini" << std::endl;
     std::cout << "\t-b\tEnables batch processing. The argument is the size of batches." << std::endl;
     std::cout << "\t-g\tGenerate visual graph using graphviz, dot file for saving" << std::endl;
-    std::cout << "\t-d\tPerform a depth first search to remove cycles" << std::endl;
+    std::cout << "\t-d\tPerform a depth first search to remove cycles before saving" << std::endl;
     std::cout << "\t-n\tNetwork model file used for generation" << std::endl;
     std::cout << "\t-x\tExploit pattern file used for generation" << std::endl;
-    std::cout << "\t-r\tUse redis for generation" << std::endl;
+    std::cout << "\t-r\tKeep the visited states and the states to expand in Redis, so several processes can share them" << std::endl;
+    std::cout << "\t-j\tWith -r, help with the run another process started on the same Redis server" << std::endl;
+    std::cout << "\t-p\tGenerate independent network components separately" << std::endl;
+    std::cout << "\t-P\tLike -p, but expand the product of the component graphs on save" << std::endl;
+    std::cout << "\t-s\tOrder precondition checks using a stats file from an earlier run" << std::endl;
+    std::cout << "\t-S\tWrite precondition hit and miss counters to a stats file" << std::endl;
+    std::cout << "\t-o\tOrder in which parallel workers expand their own states: bfs (default) or dfs" << std::endl;
+    std::cout << "\t-e\tExpected number of states, used to size the visited-state table" << std::endl;
+    std::cout << "\t-D\tDeterministic state and edge IDs, the same for any thread count" << std::endl;
+    std::cout << "\t-m\tGenerate with this many worker processes that split the states by hash" << std::endl;
+    std::cout << "\t-L\tWith -m, wait for workers on this port instead of forking them" << std::endl;
+    std::cout << "\t-W\tRun as a worker of the coordinator at host:port, using the model in the database" << std::endl;
     std::cout << "\t-h\tThis help menu." << std::endl;
+    std::cout << std::endl << "Limits, generation stops and saves the partial graph once one is reached:" << std::endl;
+    std::cout << "\t--max-states N\tNumber of states" << std::endl;
+    std::cout << "\t--max-edges N\tNumber of edges" << std::endl;
+    std::cout << "\t--max-rss N\tResident memory in bytes, with an optional K, M or G suffix" << std::endl;
+    std::cout << "\t--max-seconds N\tGeneration time" << std::endl;
+    std::cout << std::endl << "Path bounds, states past them are kept but not expanded:" << std::endl;
+    std::cout << "\t--max-depth N\tExploits along an attack path" << std::endl;
+    std::cout << "\t--max-fired X=N\tTimes exploit X fires along an attack path, at most "
+              << NetworkState::MAX_FIRED << ", repeatable" << std::endl;
+    std::cout << std::endl << "\t--dominance\tDo not expand states whose facts another state has and more of,"
+              << " on attributes no exploit updates or deletes. Keeps every reachable fact, not every path"
+              << std::endl;
+    std::cout << std::endl << "\t--estimate[=N]\tOnly estimate the size of the graph, expanding up to N states"
+              << " (default " << ESTIMATE_SAMPLES << ") per level" << std::endl;
+    std::cout << std::endl << "Simulation, random walks instead of the whole graph:" << std::endl;
+    std::cout << "\t--simulate N\tRun N random walks from the initial state" << std::endl;
+    std::cout << "\t--goal G\tCount the walks that reach the quality G, written asset,property=value" << std::endl;
+    std::cout << "\t--weights F\tPick exploits by the weights in F, one exploit name and weight per line" << std::endl;
+    std::cout << "\t--max-steps N\tCut walks off after N steps (default 1000)" << std::endl;
+    std::cout << "\t--seed N\tSeed of the walks" << std::endl;
+}
+
+/**
+ * @brief      Encodes a goal quality written asset,property=value
+ */
+Fact parse_goal(const std::string &goal, const AGGenInstance &instance) {
+    size_t comma = goal.find(',');
+    size_t equals = goal.find('=', comma);
+    if (comma == std::string::npos || equals == std::string::npos) {
+        fprintf(stderr, "Malformed goal %s, use asset,property=value.\n", goal.c_str());
+        exit(EXIT_FAILURE);
+    }
+    std::string asset = goal.substr(0, comma);
+    std::string property = goal.substr(comma + 1, equals - comma - 1);
+    std::string value = goal.substr(equals + 1);
+
+    for (size_t i = 0; i < instance.assets.size(); i++) {
+        if (instance.assets[i].get_name() != asset)
+            continue;
+        if (instance.facts.find(property) < 0 || instance.facts.find(value) < 0) {
+            fprintf(stderr, "Goal %s never holds, the model has no such property or value.\n", goal.c_str());
+            exit(EXIT_FAILURE);
+        }
+        return Quality(i, property, "=", value, instance.facts).encode(instance.layout);
+    }
+    fprintf(stderr, "Unknown asset in goal %s.\n", goal.c_str());
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief      Parses a byte count with an optional K, M or G suffix
+ */
+size_t parse_bytes(const std::string &arg) {
+    size_t end = 0;
+    size_t bytes = std::stoul(arg, &end);
+    if (end < arg.size()) {
+        switch (toupper(arg[end])) {
+        case 'G':
+            bytes <<= 10;
+            // fall through
+        case 'M':
+            bytes <<= 10;
+            // fall through
+        case 'K':
+            bytes <<= 10;
+            break;
+        default:
+            fprintf(stderr, "Unknown size suffix in %s, use K, M or G.\n", arg.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+    return bytes;
 }
 
 inline bool file_exists(const std::string &name) {
@@ -379,8 +384,6 @@ int main(int argc, char *argv[]) {
     //------------------------------
     //Program block 1: initialization and database connection
     //------------------------------
-    int thread_count=strtol(argv[5],NULL,10);
-    int init_qsize=strtol(argv[6],NULL,10); 
     struct timeval ts1,tf1,ts2,tf2,ts3,tf3;
     gettimeofday(&ts1,NULL);
     if (argc < 2) {
@@ -393,15 +396,104 @@ int main(int argc, char *argv[]) {
     std::string opt_config;
     std::string opt_graph;
     std::string opt_batch;
+    std::string opt_stats_in;
+    std::string opt_stats_out;
 
     bool should_graph = false;
     bool no_cycles = false;
     bool batch_process = false;
     bool use_redis = false;
+    bool join_redis = false;
+    bool decompose = false;
+    bool expand_product = false;
+    SEARCH_ORDER_T search_order = BREADTH_FIRST_T;
+    size_t expected_states = 0;
+    bool deterministic = false;
+    int partition_workers = 0;
+    int partition_port = 0;
+    std::string opt_coordinator;
+    GenerationLimits limits;
+    size_t estimate_samples = 0;
+    SimulationOptions simulation;
+    std::vector<std::string> opt_goals;
+    std::string opt_weights;
+    size_t max_depth = 0;
+    std::vector<std::string> opt_max_fired;
+    bool dominance = false;
+
+    enum {
+        MAX_STATES_OPT = 256,
+        MAX_EDGES_OPT,
+        MAX_RSS_OPT,
+        MAX_SECONDS_OPT,
+        MAX_DEPTH_OPT,
+        MAX_FIRED_OPT,
+        DOMINANCE_OPT,
+        ESTIMATE_OPT,
+        SIMULATE_OPT,
+        GOAL_OPT,
+        WEIGHTS_OPT,
+        MAX_STEPS_OPT,
+        SEED_OPT
+    };
+    static const struct option long_options[] = {
+        {"max-states", required_argument, nullptr, MAX_STATES_OPT},
+        {"max-edges", required_argument, nullptr, MAX_EDGES_OPT},
+        {"max-rss", required_argument, nullptr, MAX_RSS_OPT},
+        {"max-seconds", required_argument, nullptr, MAX_SECONDS_OPT},
+        {"max-depth", required_argument, nullptr, MAX_DEPTH_OPT},
+        {"max-fired", required_argument, nullptr, MAX_FIRED_OPT},
+        {"dominance", no_argument, nullptr, DOMINANCE_OPT},
+        {"estimate", optional_argument, nullptr, ESTIMATE_OPT},
+        {"simulate", required_argument, nullptr, SIMULATE_OPT},
+        {"goal", required_argument, nullptr, GOAL_OPT},
+        {"weights", required_argument, nullptr, WEIGHTS_OPT},
+        {"max-steps", required_argument, nullptr, MAX_STEPS_OPT},
+        {"seed", required_argument, nullptr, SEED_OPT},
+        {nullptr, 0, nullptr, 0}};
 
     int opt;
-    while ((opt = getopt(argc, argv, "rb:g:dhc:n:x:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "rjb:g:dhc:n:x:pPs:S:o:e:Dm:L:W:", long_options, nullptr)) != -1) {
         switch (opt) {
+        case MAX_STATES_OPT:
+            limits.max_states = std::stoul(optarg);
+            break;
+        case MAX_EDGES_OPT:
+            limits.max_edges = std::stoul(optarg);
+            break;
+        case MAX_RSS_OPT:
+            limits.max_rss = parse_bytes(optarg);
+            break;
+        case MAX_SECONDS_OPT:
+            limits.max_seconds = std::stod(optarg);
+            break;
+        case MAX_DEPTH_OPT:
+            max_depth = std::stoul(optarg);
+            break;
+        case MAX_FIRED_OPT:
+            opt_max_fired.emplace_back(optarg);
+            break;
+        case DOMINANCE_OPT:
+            dominance = true;
+            break;
+        case ESTIMATE_OPT:
+            estimate_samples = optarg ? std::stoul(optarg) : ESTIMATE_SAMPLES;
+            break;
+        case SIMULATE_OPT:
+            simulation.walks = std::stoul(optarg);
+            break;
+        case GOAL_OPT:
+            opt_goals.emplace_back(optarg);
+            break;
+        case WEIGHTS_OPT:
+            opt_weights = optarg;
+            break;
+        case MAX_STEPS_OPT:
+            simulation.max_steps = std::stoul(optarg);
+            break;
+        case SEED_OPT:
+            simulation.seed = std::stoul(optarg);
+            break;
         case 'g':
             should_graph = true;
             opt_graph = optarg;
@@ -424,10 +516,49 @@ int main(int argc, char *argv[]) {
         case 'r':
             use_redis = true;
             break;
+        case 'j':
+            join_redis = true;
+            break;
         case 'b':
             batch_process = true;
             opt_batch = optarg;
             break;
+        case 'p':
+            decompose = true;
+            break;
+        case 'P':
+            decompose = true;
+            expand_product = true;
+            break;
+        case 's':
+            opt_stats_in = optarg;
+            break;
+        case 'S':
+            opt_stats_out = optarg;
+            break;
+        case 'e':
+            expected_states = std::stoul(optarg);
+            break;
+        case 'D':
+            deterministic = true;
+            break;
+        case 'm':
+            partition_workers = std::stoi(optarg);
+            break;
+        case 'L':
+            partition_port = std::stoi(optarg);
+            break;
+        case 'W':
+            opt_coordinator = optarg;
+            break;
+        case 'o':
+            if (strcmp(optarg, "dfs") == 0) {
+                search_order = DEPTH_FIRST_T;
+            } else if (strcmp(optarg, "bfs") != 0) {
+                fprintf(stderr, "Unknown search order %s, use bfs or dfs.\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case '?':
             if (optopt == 'c')
                 fprintf(stderr, "Option -%c requires an argument.\n", optopt);
@@ -442,6 +573,14 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    // thread_count and init_qsize follow the options on the command line
+    if (argc - optind < 2) {
+        print_usage();
+        exit(EXIT_FAILURE);
+    }
+    int thread_count=strtol(argv[optind],NULL,10);
+    int init_qsize=strtol(argv[optind+1],NULL,10);
+
     printf("Finished init\n");
 
     std::string config_section = (opt_config.empty()) ? "default" : opt_config;
@@ -489,12 +628,18 @@ int main(int argc, char *argv[]) {
        }
        parsedxp = parse_xp(opt_xp);
     }
+    if (!opt_stats_in.empty() && !file_exists(opt_stats_in)) {
+        fprintf(stderr, "File %s doesn't exist.\n", opt_stats_in.c_str());
+        exit(EXIT_FAILURE);
+    }
     int batch_size = 0;
     if (batch_process)
        batch_size = std::stoi(opt_batch);
 
     std::cout << "Importing Models and Exploits into Database: ";
-    import_models(parsednm, parsedxp); //directly use the strings parsednm and parsedxp as SQL commands
+    // A remote worker uses the model its coordinator already imported
+    if (opt_coordinator.empty())
+        import_models(parsednm, parsedxp); //directly use the strings parsednm and parsedxp as SQL commands
     gettimeofday(&tf3,NULL);
     double tdiff3=(tf3.tv_sec-ts3.tv_sec)*1000.0+(tf3.tv_usec-ts3.tv_usec)/1000.0;
     std::cout << "Done\n";
@@ -511,32 +656,217 @@ int main(int argc, char *argv[]) {
     _instance.initial_qualities = fetch_all_qualities(_instance.facts);  //prepare all the initial qualities, return a Quality vector of (quality plus facts)
     _instance.initial_topologies = fetch_all_topologies(_instance.facts); //prepare all the initial topologies, return a Topology vector of (topology plus facts)
     _instance.assets = fetch_all_assets(_instance.facts); //fetch each asset name and its related qualities. 
+    _instance.layout = FactLayout::choose(_instance.assets.size(), _instance.facts.size()); //narrowest encoding that fits the model
     _instance.exploits = fetch_all_exploits(); //fetch each exploit and its precondition and post conditions from initial exploits
     auto ex = fetch_all_exploits(); //make a copy of initial exploits
 
     std::cout << "Assets: " << _instance.assets.size() << "\n"; //# of assets, vector size
     std::cout << "Exploits: " << _instance.exploits.size() << "\n"; //# of exploits, vector size
     std::cout << "Facts: " << _instance.facts.size() << "\n"; //how many different parameters and values are there? class size() method
+    std::cout << "Fact Encoding: " << _instance.layout.total_bits() << " bits, "
+              << _instance.layout.words() * 64 << "-bit words\n";
+
+    if (estimate_samples > 0) {
+        std::cout << "Estimating Attack Graph from up to " << estimate_samples << " states per level\n";
+        GraphEstimate estimate = estimate_graph(_instance, estimate_samples);
+        printf("%6s %14s %14s %10s %8s\n", "Depth", "States", "Edges", "Branching", "Sampled");
+        for (size_t depth = 0; depth < estimate.levels.size(); depth++) {
+            const LevelEstimate &level = estimate.levels[depth];
+            printf("%6zu %14.0f %14.0f %10.2f %8zu%s\n", depth, level.states, level.edges, level.branching,
+                   level.sampled, level.exact ? " exact" : level.lower_bound ? " low" : "");
+        }
+        const char *at_least = estimate.lower_bound ? "at least " : "";
+        printf("Estimated States: %s%.0f\n", at_least, estimate.states);
+        printf("Estimated Edges: %s%.0f\n", at_least, estimate.edges);
+        printf("Estimated Memory: %.1f MB, with up to %.0f states on the frontier\n", estimate.bytes / 1e6,
+               estimate.peak_frontier);
+        printf("Estimation took %lf seconds, pass -e %.0f to size the visited-state table\n",
+               estimate.elapsed_seconds, estimate.states);
+        if (estimate.lower_bound) {
+            printf("Warning: as little as %.2f%% of a level was sampled, so the levels marked low and the\n"
+                   "totals are lower bounds, possibly several times too low. Rerun with a larger --estimate=N.\n",
+                   100 * estimate.min_fraction);
+        }
+        return 0;
+    }
+
+    if (simulation.walks > 0) {
+        for (const auto &goal : opt_goals)
+            simulation.goals.push_back(parse_goal(goal, _instance));
+        if (!opt_weights.empty())
+            simulation.weights = load_exploit_weights(opt_weights, _instance.exploits);
+
+        std::cout << "Simulating " << simulation.walks << " random walks: " << std::flush;
+        SimulationResult result = simulate_walks(_instance, simulation, thread_count);
+        std::cout << "Done\n";
+        std::cout << "Total Time: " << result.elapsed_seconds << " seconds\n";
+
+        double walks = result.walks;
+        for (size_t g = 0; g < opt_goals.size(); g++) {
+            printf("Goal %s: reached by %.4f%% of walks, after %.2f steps on average\n", opt_goals[g].c_str(),
+                   100.0 * result.goal_hits[g] / walks, result.goal_steps[g]);
+        }
+        if (!opt_goals.empty())
+            printf("Any goal: reached by %.4f%% of walks\n", 100.0 * result.reached_any / walks);
+
+        // Walk length percentiles from the histogram
+        size_t total = 0;
+        double sum = 0;
+        printf("Walk lengths:");
+        for (double pct : {0.1, 0.5, 0.9, 0.99, 1.0}) {
+            size_t below = 0;
+            size_t len = 0;
+            while (len < result.lengths.size() && (below += result.lengths[len]) < pct * walks)
+                len++;
+            printf(" p%g %zu", pct * 100, len);
+        }
+        for (size_t len = 0; len < result.lengths.size(); len++) {
+            total += result.lengths[len];
+            sum += static_cast<double>(len) * result.lengths[len];
+        }
+        printf(", mean %.2f, %zu cut off at %zu steps\n", total ? sum / total : 0.0, result.cut_off,
+               simulation.max_steps);
+
+        printf("Most frequent exploit sequences%s:\n", opt_goals.empty() ? "" : " up to the first goal");
+        for (const auto &seq : result.sequences) {
+            printf("%10zu ", seq.second);
+            for (size_t i = 0; i < seq.first.size(); i++)
+                printf("%s%s", i ? " -> " : "", _instance.exploits[seq.first[i]].get_name().c_str());
+            printf("%s\n", seq.first.empty() ? "(none)" : "");
+        }
+        if (result.untracked > 0)
+            printf("%zu walks took sequences too rare to count\n", result.untracked);
+        return 0;
+    }
+
+    if (!opt_coordinator.empty()) {
+        std::cout << "Generating as a worker of " << opt_coordinator << ": " << std::flush;
+        run_partition_worker(_instance, opt_coordinator);
+        std::cout << "Done\n";
+        return 0;
+    }
+
+    PathLimits paths;
+    paths.max_depth = max_depth;
+    for (const auto &bound : opt_max_fired) {
+        size_t equals = bound.rfind('=');
+        std::string name = bound.substr(0, equals);
+        auto it = std::find_if(_instance.exploits.begin(), _instance.exploits.end(),
+                               [&](const Exploit &ex) { return ex.get_name() == name; });
+        if (equals == std::string::npos || it == _instance.exploits.end()) {
+            fprintf(stderr, "Unknown exploit in --max-fired %s, use exploit=count.\n", bound.c_str());
+            exit(EXIT_FAILURE);
+        }
+        size_t count = std::stoul(bound.substr(equals + 1));
+        if (count > NetworkState::MAX_FIRED) {
+            fprintf(stderr, "--max-fired %s is above the largest count, %zu.\n", bound.c_str(),
+                    NetworkState::MAX_FIRED);
+            exit(EXIT_FAILURE);
+        }
+        paths.max_fired.resize(_instance.exploits.size(), SIZE_MAX);
+        paths.max_fired[it - _instance.exploits.begin()] = count;
+    }
+
+    if (partition_workers > 0 && (paths.max_depth || paths.counts_fired())) {
+        fprintf(stderr, "Path bounds are not supported with -m.\n");
+        exit(EXIT_FAILURE);
+    }
 
     AGGenInstance postinstance;
+    bool joined = false; //this process joined a Redis run another process started
 
     std::cout << "Generating Attack Graph: " << std::flush;
-    AGGen gen(_instance);//use AGGen class to instantiate an obj with the name gen! _instance obj as the parameter! constructor defined in ag_gen.cpp
-    postinstance = gen.generate(batch_process, batch_size, thread_count, init_qsize); //The method call to generate the attack graph, defined in ag_gen.cpp.
+    if ((decompose || partition_workers > 0) && !(opt_stats_in.empty() && opt_stats_out.empty()))
+        std::cout << "Precondition stats are not used with -p, -P or -m\n";
+    if (decompose && partition_workers == 0 && (limits.max_states || limits.max_edges))
+        std::cout << "State and edge limits apply to each component with -p or -P\n";
+    else if (partition_workers > 0 && (limits.max_states || limits.max_edges || limits.max_rss))
+        std::cout << "State, edge and memory limits are split between the workers with -m\n";
+    if (dominance && (decompose || partition_workers > 0 || deterministic || use_redis))
+        std::cout << "Dominance pruning is not applied with -p, -P, -m, -D or -r\n";
+    else if (dominance && (paths.max_depth || paths.counts_fired()))
+        std::cout << "Dominance pruning is not applied with path bounds\n";
+    if (partition_workers > 0) {
+        if (decompose)
+            std::cout << "Components are not split with -m\n";
+        postinstance = generate_partitioned(_instance, partition_workers, partition_port, limits);
+    } else if (decompose) {
+        //split the model into independent components and generate each one separately
+        auto components = decompose_instance(_instance);
+        std::cout << "Components: " << components.size() << "\n";
+        auto start = std::chrono::system_clock::now();
+        auto results = generate_components(components, batch_process, batch_size, thread_count, init_qsize,
+                                           deterministic, limits, paths);
+        auto end = std::chrono::system_clock::now();
+        // Exact up to 10^15 states, in exponent notation past that
+        printf("Product States: %.15g\n", product_size(results));
+        if (expand_product) {
+            try {
+                postinstance = expand_components(results);
+            } catch (const std::overflow_error &e) {
+                fprintf(stderr, "Cannot expand the product with -P: %s.\n", e.what());
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            postinstance = merge_components(results);
+        }
+        postinstance.elapsed_seconds = end - start;
+    } else {
+        std::unique_ptr<AGGen> gen;
+#ifdef REDIS
+        std::unique_ptr<RedisManager> rman;
+        if (use_redis) {
+            std::vector<std::pair<std::string, std::string>> scripts{
+                {"insert_or_get", read_file("redis_scripts/insert_or_get.lua")},
+                {"take_work", read_file("redis_scripts/take_work.lua")}};
+            rman.reset(new RedisManager(pt.get<std::string>("redis.host", "localhost"),
+                                        pt.get<int>("redis.port", 6379), scripts));
+            if (!join_redis)
+                rman->clear();
+            joined = join_redis;
+            gen.reset(new AGGen(_instance, *rman));
+        }
+#else
+        if (use_redis || join_redis)
+            std::cout << "Built without Redis, keeping the visited states in memory\n";
+#endif
+        if (!gen)
+            gen.reset(new AGGen(_instance)); //constructor defined in ag_gen.cpp
+        gen->set_search_order(search_order);
+        gen->reserve_states(expected_states);
+        gen->set_deterministic(deterministic);
+        gen->set_limits(limits);
+        gen->set_path_limits(paths);
+        gen->set_dominance(dominance);
+        if (!opt_stats_in.empty())
+            gen->load_stats(opt_stats_in); //start from the precondition order an earlier run learned
+        postinstance = gen->generate(batch_process, batch_size, thread_count, init_qsize); //The method call to generate the attack graph, defined in ag_gen.cpp.
+        if (!opt_stats_out.empty())
+            gen->save_stats(opt_stats_out);
+    }
 
     std::cout << "Done\n";
 
     std::cout << "Total Time: " << postinstance.elapsed_seconds.count() << " seconds\n";
     std::cout << "Total States: " << postinstance.factbases.size() << "\n";
+    if (!postinstance.stop_reason.empty())
+        std::cout << "Stopped at " << postinstance.stop_reason << "\n";
+    if (!postinstance.unexpanded.empty())
+        std::cout << "Unexpanded States: " << postinstance.unexpanded.size() << "\n";
+    if (!postinstance.dominated.empty())
+        std::cout << "Dominated States: " << postinstance.dominated.size() << "\n";
+    if (no_cycles)
+        std::cout << "Cyclic Edges Removed: " << remove_cycles(postinstance) << "\n";
     std::cout << "Saving Attack Graph to Database: " << std::flush;
-    save_ag_to_db(postinstance, true);
+    // The process that started a shared Redis run stores the facts for all of them
+    save_ag_to_db(postinstance, !joined);
     std::cout << "Done\n";
 
-    //for -g option: write graphviz dot file (using database)
+    //for -g option: write graphviz dot file from the generated graph
     if (should_graph) {
-	    std::cout << "Writing graphviz dot file (using database) to: " << opt_graph << std::endl;
-	    Graph graphviz = graph_init();
-	    graph_ag(graphviz, opt_graph);
+	    std::cout << "Writing graphviz dot file to: " << opt_graph << std::endl;
+	    std::ofstream gout(opt_graph);
+	    StateGraph(postinstance).write_graphviz(gout);
     }
     
     gettimeofday(&tf1,NULL);
@@ -0,0 +1,187 @@
+// bench.cpp builds a synthetic network model in memory and times attack graph
+// generation on it. No database is needed. Every call to the global allocator
+// made during generation is counted, so changes to the engine's allocation
+// behaviour can be compared run to run.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "ag_gen/ag_gen.h"
+
+static std::atomic<size_t> allocations{0};
+
+// The whole family of global allocation functions is replaced, so that every
+// operator delete frees what the matching operator new got from malloc
+static void *counted_alloc(size_t n, size_t align = 0) noexcept {
+    allocations++;
+    if (align <= alignof(std::max_align_t))
+        return std::malloc(n ? n : 1);
+    // aligned_alloc wants a size that is a multiple of the alignment
+    return std::aligned_alloc(align, (n + align - 1) / align * align);
+}
+
+static void *counted_alloc_or_throw(size_t n, size_t align = 0) {
+    if (void *p = counted_alloc(n, align))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t n) { return counted_alloc_or_throw(n); }
+void *operator new[](size_t n) { return counted_alloc_or_throw(n); }
+void *operator new(size_t n, const std::nothrow_t &) noexcept { return counted_alloc(n); }
+void *operator new[](size_t n, const std::nothrow_t &) noexcept { return counted_alloc(n); }
+void *operator new(size_t n, std::align_val_t a) { return counted_alloc_or_throw(n, size_t(a)); }
+void *operator new[](size_t n, std::align_val_t a) { return counted_alloc_or_throw(n, size_t(a)); }
+void *operator new(size_t n, std::align_val_t a, const std::nothrow_t &) noexcept {
+    return counted_alloc(n, size_t(a));
+}
+void *operator new[](size_t n, std::align_val_t a, const std::nothrow_t &) noexcept {
+    return counted_alloc(n, size_t(a));
+}
+
+// Out of line, so GCC does not see free() meet the operator new it replaces
+// and warn about a mismatched deallocation at -O1 and above
+__attribute__((noinline)) static void counted_free(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t) noexcept { counted_free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { counted_free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { counted_free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { counted_free(p); }
+
+void print_usage() {
+    std::cout << "Usage: ag_bench [OPTIONS...]" << std::endl
+              << "\t-h\tShows this help menu." << std::endl
+              << "\t-n\tNumber of vulnerable hosts (default 2)." << std::endl
+              << "\t-s\tSegment the network: every host gets its own router." << std::endl
+              << "\t-t\tNumber of worker threads (default 1)." << std::endl
+              << "\t-d\tParallel workers expand their newest state first." << std::endl
+              << "\t-e\tExpected number of states, sizes the visited-state table." << std::endl
+              << "\t-D\tDeterministic state and edge IDs." << std::endl;
+}
+
+/**
+ * @brief Builds the cars3_rsh example scaled to a number of hosts
+ * @details Every host carries the four vulnerable services of the example and
+ *          is linked to a router. The five exploits of cars3_rsh.xp are used.
+ */
+AGGenInstance build_instance(int hosts, bool segmented) {
+    AGGenInstance instance;
+    instance.facts.populate({"kernel_version", "44.9", "opensmtpd_version", "66.2",
+                             "apache_version", "24.10", "rsh", "enabled", "connected", "",
+                             "priv_esc", "true", "dos", "mitm", "remote_execution", "root"});
+
+    instance.assets.emplace_back("ap", std::vector<Quality>{});
+    instance.assets.emplace_back("pc", std::vector<Quality>{});
+    instance.initial_topologies.emplace_back(0, 1, BIDIRECTION_T, "connected", "", "", instance.facts);
+
+    for (int h = 0; h < hosts; h++) {
+        int router = 0;
+        if (segmented) {
+            router = instance.assets.size();
+            instance.assets.emplace_back("router" + std::to_string(h), std::vector<Quality>{});
+        }
+        int id = instance.assets.size();
+        instance.assets.emplace_back("car" + std::to_string(h), std::vector<Quality>{});
+        instance.initial_qualities.emplace_back(id, "kernel_version", ":=", "44.9", instance.facts);
+        instance.initial_qualities.emplace_back(id, "opensmtpd_version", ":=", "66.2", instance.facts);
+        instance.initial_qualities.emplace_back(id, "apache_version", ":=", "24.10", instance.facts);
+        instance.initial_qualities.emplace_back(id, "rsh", "=", "enabled", instance.facts);
+        instance.initial_topologies.emplace_back(router, id, BIDIRECTION_T, "connected", "", "", instance.facts);
+    }
+
+    using Pre = std::tuple<std::vector<ParameterizedQuality>, std::vector<ParameterizedTopology>>;
+    using Post = std::tuple<std::vector<PostconditionQ>, std::vector<PostconditionT>>;
+    auto add = [&](std::string name, int params, Pre pre, ParameterizedQuality post) {
+        Post postconds{{std::make_tuple(ADD_T, post)}, {}};
+        instance.exploits.emplace_back(instance.exploits.size(), name, params, pre, postconds);
+    };
+
+    add("kernel_exploit", 1, Pre{{{0, "kernel_version", "44.9"}}, {}}, {0, "priv_esc", "true"});
+    add("apache_exploit", 1, Pre{{{0, "apache_version", "24.10"}}, {}}, {0, "dos", "true"});
+    add("rsh_mitm", 1, Pre{{{0, "rsh", "enabled"}}, {}}, {0, "mitm", "true"});
+    add("root_remote_execution", 1,
+        Pre{{{0, "priv_esc", "true"}, {0, "remote_execution", "true"}}, {}}, {0, "root", "true"});
+    add("opensmtpd_exploit", 2,
+        Pre{{{1, "opensmtpd_version", "66.2"}}, {{0, 1, FORWARD_T, "connected", "", ""}}},
+        {1, "remote_execution", "true"});
+
+    instance.layout = FactLayout::choose(instance.assets.size(), instance.facts.size());
+    return instance;
+}
+
+int main(int argc, char *argv[]) {
+    int hosts = 2;
+    bool segmented = false;
+    int threads = 1;
+    SEARCH_ORDER_T order = BREADTH_FIRST_T;
+    size_t expected_states = 0;
+    bool deterministic = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hn:st:de:D")) != -1) {
+        switch (opt) {
+        case 'n':
+            hosts = std::stoi(optarg);
+            break;
+        case 's':
+            segmented = true;
+            break;
+        case 't':
+            threads = std::stoi(optarg);
+            break;
+        case 'd':
+            order = DEPTH_FIRST_T;
+            break;
+        case 'e':
+            expected_states = std::stoul(optarg);
+            break;
+        case 'D':
+            deterministic = true;
+            break;
+        case 'h':
+            print_usage();
+            return 0;
+        default:
+            print_usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    AGGenInstance instance = build_instance(hosts, segmented);
+    std::cout << "Assets: " << instance.assets.size() << "\n";
+    std::cout << "Exploits: " << instance.exploits.size() << "\n";
+    std::cout << "Threads: " << threads << "\n";
+
+    AGGen gen(instance);
+    gen.set_search_order(order);
+    gen.reserve_states(expected_states);
+    gen.set_deterministic(deterministic);
+    size_t before = allocations;
+    AGGenInstance result = gen.generate(false, 0, threads, 1);
+    size_t allocs = allocations - before;
+
+    size_t states = result.factbases.size();
+    std::cout << "States: " << states << "\n";
+    std::cout << "Edges: " << result.edges.size() << "\n";
+    std::cout << "Time: " << result.elapsed_seconds.count() << " seconds\n";
+    std::cout << "Allocations: " << allocs << "\n";
+    std::cout << "Allocations per state: " << (states ? allocs / states : 0) << "\n";
+
+    return 0;
+}
@@ -12,6 +12,7 @@
 #include <boost/property_tree/ini_parser.hpp>
 
 #include "ag_gen/asset.h"
+#include "ag_gen/graph.h"
 #include "ag_gen/quality.h"
 #include "ag_gen/topology.h"
 
@@ -22,22 +23,15 @@ void print_usage() {
     std::cout << "Usage: fbitems [OPTIONS...]" << std::endl
               << "\t-h\tShows this help menu." << std::endl
               << "\t-i\tindex. If no index provided, all items will be found." << std::endl
-              << "\t-c\tconfig section. If none is provided, default will be used." << std::endl;
+              << "\t-c\tconfig section. If none is provided, default will be used." << std::endl
+              << "\t-g\twrite the stored graph as a graphviz dot file instead." << std::endl;
 }
 
 std::string find_one_impl(std::vector<std::string> &str_vector, int index) {
-    std::vector<std::pair<size_t, std::string>> fbitems;
+    std::vector<std::pair<Fact, std::string>> fbitems;
 
     std::ostringstream output;
 
-    std::vector<EncodedQuality> cmpq_base;
-    auto cmpq = [](EncodedQuality &a, EncodedQuality &b) { return a.dec.asset_id < b.dec.asset_id; };
-    std::priority_queue<EncodedQuality, std::vector<EncodedQuality>, decltype(cmpq)> pqq(cmpq, cmpq_base);
-
-    std::vector<EncodedTopology> cmpt_base;
-    auto cmpt = [](EncodedTopology &a, EncodedTopology &b) { return a.dec.from_asset < b.dec.from_asset; };
-    std::priority_queue<EncodedTopology, std::vector<EncodedTopology>, decltype(cmpt)> pqt(cmpt, cmpt_base);
-
     try {
         fbitems = fetch_one_factbase_items(index);
     } catch (CustomDBException &ex) {
@@ -45,56 +39,68 @@ std::string find_one_impl(std::vector<std::string> &str_vector, int index) {
         exit(1);
     }
 
+    Keyvalue kv = fetch_kv();
+    std::vector<Asset> assets = fetch_all_assets(kv);
+
+    // The generator picked its fact layout from the same two numbers
+    FactLayout layout = FactLayout::choose(assets.size(), kv.size());
+
+    using QualityItem = std::pair<DecodedQuality, Fact>;
+    std::vector<QualityItem> cmpq_base;
+    auto cmpq = [](QualityItem &a, QualityItem &b) { return a.first.asset_id < b.first.asset_id; };
+    std::priority_queue<QualityItem, std::vector<QualityItem>, decltype(cmpq)> pqq(cmpq, cmpq_base);
+
+    using TopologyItem = std::pair<DecodedTopology, Fact>;
+    std::vector<TopologyItem> cmpt_base;
+    auto cmpt = [](TopologyItem &a, TopologyItem &b) { return a.first.from_asset < b.first.from_asset; };
+    std::priority_queue<TopologyItem, std::vector<TopologyItem>, decltype(cmpt)> pqt(cmpt, cmpt_base);
+
     for(auto &item : fbitems) {
         std::string type = item.second;
         if (type == "quality") {
-            EncodedQuality eq;
-            eq.enc = item.first;
-            pqq.emplace(eq);
+            pqq.emplace(layout.decode_quality(item.first), item.first);
         } else {
-            EncodedTopology et;
-            et.enc = item.first;
-            pqt.emplace(et);
+            pqt.emplace(layout.decode_topology(item.first), item.first);
         }
     }
 
-    Keyvalue kv = fetch_kv();
-    std::vector<Asset> assets = fetch_all_assets(kv);
     output << index << ":";
 
     while(!pqq.empty()) {
-        EncodedQuality qual = pqq.top();
+        DecodedQuality qual = pqq.top().first;
+        Fact enc = pqq.top().second;
         pqq.pop();
 
         output << "\tquality:";
 
-        Asset asset = assets[qual.dec.asset_id];
+        Asset asset = assets[qual.asset_id];
         output << asset.get_name() << ",";
 
-        std::string attr = str_vector[qual.dec.attr];
-        std::string val = str_vector[qual.dec.val];
+        std::string attr = str_vector[qual.attr];
+        std::string val = str_vector[qual.val];
 
         output << attr << "=" << val;
-        output << " : " << qual.enc << "\n";
+        output << " : " << fact_to_string(enc) << "\n";
 
     }
 
     while(!pqt.empty()) {
-        EncodedTopology topo = pqt.top();
+        DecodedTopology topo = pqt.top().first;
+        Fact enc = pqt.top().second;
         pqt.pop();
 
         output << "\ttopology:";
 
-        Asset from_asset = assets[topo.dec.from_asset];
-        Asset to_asset = assets[topo.dec.to_asset];
+        Asset from_asset = assets[topo.from_asset];
+        Asset to_asset = assets[topo.to_asset];
 
         output << from_asset.get_name() << "->" << to_asset.get_name() << ",";
 
-        std::string prop = str_vector[topo.dec.property];
-        std::string val = str_vector[topo.dec.value];
+        std::string prop = str_vector[topo.property];
+        std::string val = str_vector[topo.value];
 
         output << prop << "=" << val;
-        output << " : " << topo.enc << "\n";
+        output << " : " << fact_to_string(enc) << "\n";
     }
 
     output << std::endl;
@@ -124,9 +130,10 @@ int main(int argc, char *argv[]) {
 
     std::string opt_config;
     std::string opt_index;
+    std::string opt_graph;
 
     int opt;
-    while ((opt = getopt(argc, argv, "hc:i:")) != -1) {
+    while ((opt = getopt(argc, argv, "hc:i:g:")) != -1) {
         switch (opt) {
         case 'c':
             opt_config = optarg;
@@ -134,11 +141,14 @@ int main(int argc, char *argv[]) {
         case 'i':
             opt_index = optarg;
             break;
+        case 'g':
+            opt_graph = optarg;
+            break;
         case 'h':
             print_usage();
             return 0;
         case '?':
-            if (optopt == 'c')
+            if (optopt == 'c' || optopt == 'g')
                 fprintf(stderr, "Option -%c requires an argument.\n", optopt);
             exit(EXIT_FAILURE);
         case ':':
@@ -165,6 +175,12 @@ int main(int argc, char *argv[]) {
     std::cout << dbName << "\n";
     init_db("postgresql://" + username + "@" + host + ":" + port + "/" + dbName);
 
+    if (!opt_graph.empty()) {
+        std::ofstream gout(opt_graph);
+        StateGraph::load().write_graphviz(gout);
+        return 0;
+    }
+
 //    Keyvalue kv = fetch_facts();
 //    std::vector<std::string> str_vector = kv.get_str_vector();
 
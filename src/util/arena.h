@@ -0,0 +1,94 @@
+#ifndef UTIL_ARENA_H
+#define UTIL_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+/** Arena class
+ * @brief Per-thread scratch memory for a single state expansion
+ * @details Transient containers built while a state is expanded (candidate
+ *          successor factbases, applicable exploit lists, ...) are carved out
+ *          of a thread-local slab with a bump pointer and released in bulk
+ *          once the expansion is finished. The slab is kept between
+ *          expansions and grows to the largest expansion seen so far, so in
+ *          the steady state an expansion makes no calls to the global
+ *          allocator for its scratch memory.
+ *
+ *          Containers that are copied out of the arena (for example a new
+ *          state pushed onto the frontier) get the default allocator, so
+ *          nothing long-lived ever points into a slab.
+ */
+class Arena {
+    /**
+     * @brief Upstream resource that records how far an expansion overflowed
+     *        the slab.
+     */
+    class Overflow : public std::pmr::memory_resource {
+        size_t bytes = 0;
+
+        void *do_allocate(size_t n, size_t align) override {
+            bytes += n;
+            return std::pmr::new_delete_resource()->allocate(n, align);
+        }
+
+        void do_deallocate(void *p, size_t n, size_t align) override {
+            std::pmr::new_delete_resource()->deallocate(p, n, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+      public:
+        size_t take() {
+            size_t n = bytes;
+            bytes = 0;
+            return n;
+        }
+    };
+
+    std::vector<std::byte> slab;
+    Overflow overflow;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> resource;
+
+  public:
+    static constexpr size_t DEFAULT_SLAB_SIZE = 1 << 20;
+
+    explicit Arena(size_t slab_size = DEFAULT_SLAB_SIZE)
+        : slab(slab_size),
+          resource(new std::pmr::monotonic_buffer_resource(slab.data(), slab.size(), &overflow)) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    std::pmr::memory_resource *get() { return resource.get(); }
+
+    /**
+     * @brief Frees everything allocated since the last release
+     * @details If the last expansion did not fit in the slab, the slab is
+     *          grown so the next one of the same size does.
+     */
+    void release() {
+        resource->release();
+        size_t spilled = overflow.take();
+        if (spilled > 0) {
+            resource.reset();
+            slab.resize(slab.size() + spilled);
+            resource.reset(new std::pmr::monotonic_buffer_resource(slab.data(), slab.size(), &overflow));
+        }
+    }
+
+    size_t capacity() const { return slab.size(); }
+
+    /**
+     * @return The calling thread's arena
+     */
+    static Arena &local() {
+        thread_local Arena arena;
+        return arena;
+    }
+};
+
+#endif // UTIL_ARENA_H
@@ -6,6 +6,7 @@
  */
 
 #include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
@@ -64,6 +65,6 @@ std::vector<std::string> split(std::string str, char delim) {
 
 std::string trim(std::string str) {
     str.erase(str.begin(), std::find_if(str.begin(), str.end(),
-                                   not1(std::ptr_fun<int, int>(isspace))));
+                                   [](unsigned char c) { return !std::isspace(c); }));
     return str;
 }
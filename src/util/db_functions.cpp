@@ -54,22 +54,6 @@ Keyvalue fetch_kv() {
     return kv;
 }
 
-void delete_edges(std::vector<int> edge_ids) {
-    std::ostringstream ss;
-
-    ss << "(";
-
-    std::copy(edge_ids.begin(), edge_ids.end() - 1, std::ostream_iterator<int>(ss, ", "));
-    ss << edge_ids.back() << ")";
-
-    std::string ids = ss.str();
-
-    std::string sql = "DELETE FROM edge_asset_binding WHERE edge_id IN " + ids
-                    + "; DELETE FROM edge WHERE id IN" + ids + ";";
-
-    db.exec(sql);
-}
-
 GraphInfo fetch_graph_info() {
     std::vector<Row> factbase_rows = db.exec("SELECT id FROM factbase ORDER BY id;");
     std::vector<Row> edge_rows = db.exec("SELECT * FROM edge ORDER BY id;");
@@ -95,8 +79,8 @@ GraphInfo fetch_graph_info() {
     return std::make_pair(factbase_ids, edges);
 }
 
-std::vector<std::vector<std::pair<size_t, std::string>>> fetch_all_factbase_items() {
-    std::vector<std::vector<std::pair<size_t, std::string>>> fi;
+std::vector<std::vector<std::pair<Fact, std::string>>> fetch_all_factbase_items() {
+    std::vector<std::vector<std::pair<Fact, std::string>>> fi;
     std::vector<Row> firows = db.exec("SELECT * FROM factbase_item;");
     if (firows.empty())
         throw CustomDBException();
@@ -108,24 +92,20 @@ std::vector<std::vector<std::pair<size_t, std::string>>> fetch_all_factbase_item
             current_index = index;
             fi.emplace_back();
         }
-        size_t st;
-        sscanf(firow[1].c_str(), "%zu", &st);
-        fi[index].push_back(make_pair(st, firow[2]));
+        fi[index].push_back(make_pair(parse_fact(firow[1]), firow[2]));
     }
 
     return fi;
 }
 
-std::vector<std::pair<size_t, std::string>> fetch_one_factbase_items(int index) {
-    std::vector<std::pair<size_t, std::string>> fi;
+std::vector<std::pair<Fact, std::string>> fetch_one_factbase_items(int index) {
+    std::vector<std::pair<Fact, std::string>> fi;
     std::vector<Row> firows = db.exec("SELECT f,type FROM factbase_item WHERE factbase_id=" + std::to_string(index) + ";");
     if (firows.empty())
         throw CustomDBException();
 
     for (auto firow : firows) {
-        size_t st;
-        sscanf(firow[0].c_str(), "%zu", &st);
-        fi.push_back(std::make_pair(st, firow[1]));
+        fi.push_back(std::make_pair(parse_fact(firow[0]), firow[1]));
     }
 
     return fi;
@@ -140,6 +120,10 @@ std::vector<std::string> fetch_unique_values() { //from the database to fetch al
                               "UNION DISTINCT\n"
                               "SELECT value FROM exploit_postcondition\n"
                               "UNION DISTINCT\n"
+                              "SELECT property FROM exploit_precondition\n"
+                              "UNION DISTINCT\n"
+                              "SELECT value FROM exploit_precondition\n"
+                              "UNION DISTINCT\n"
                               "SELECT property FROM topology\n"
                               "UNION DISTINCT\n"
                               "SELECT value FROM topology;";//all the values and properties will be distinct from each other
@@ -268,8 +252,9 @@ fetch_exploit_preconds() {
             int param1 = stoi(row[3]);
             std::string property = row[5];
             std::string value = row[6];
+            std::string op = row[7];
 
-            ParameterizedQuality qual{param1, property, value};
+            ParameterizedQuality qual{param1, property, value, op};
             preconds_q.push_back(qual);
         } else { //type 1 is topology-typed precondition
             int param1 = stoi(row[3]);
@@ -420,7 +405,7 @@ std::vector<Exploit> fetch_all_exploits() {
  * @details Grabs all of the qualities in the database associated with
  *          the Asset's ID and gives them to the Asset
  */
-std::unordered_map<int, std::vector<Quality>> fetch_asset_qualities(Keyvalue &facts) {
+std::unordered_map<int, std::vector<Quality>> fetch_asset_qualities(const Keyvalue &facts) {
     std::vector<Row> rows = db.exec("SELECT * FROM quality;");
 
     std::unordered_map<int, std::vector<Quality>> qmap;
@@ -458,7 +443,7 @@ std::unordered_map<int, std::vector<Quality>> fetch_asset_qualities(Keyvalue &fa
  *
  * @param network Name of the network to grab from
  */
-std::vector<Asset> fetch_all_assets(Keyvalue &facts) {
+std::vector<Asset> fetch_all_assets(const Keyvalue &facts) {
     std::vector<Row> rows = db.exec("SELECT * FROM asset;");  
     std::vector<Asset> new_assets; //use class Asset (in asset.h) to define a vector, each element will be an object
 
@@ -474,7 +459,7 @@ std::vector<Asset> fetch_all_assets(Keyvalue &facts) {
     return new_assets;
 }
 
-std::vector<Quality> fetch_all_qualities(Keyvalue &facts) {
+std::vector<Quality> fetch_all_qualities(const Keyvalue &facts) {
     std::vector<Quality> qualities;
     std::vector<Row> rows = db.exec("SELECT * FROM quality;");
 
@@ -491,7 +476,7 @@ std::vector<Quality> fetch_all_qualities(Keyvalue &facts) {
     return qualities;
 }
 
-std::vector<Topology> fetch_all_topologies(Keyvalue &facts) {
+std::vector<Topology> fetch_all_topologies(const Keyvalue &facts) {
     std::vector<Topology> topologies;
 
     std::vector<Row> rows = db.exec("SELECT * FROM topology;");
@@ -534,7 +519,8 @@ Keyvalue fetch_facts() { //Keyvalue is a class name(defined in Keyvalue.h), this
 void save_ag_to_db(AGGenInstance &instance, bool save_keyvalue){
     std::vector<FactbaseItems>& factbase_items = instance.factbase_items;
     std::vector<Factbase>& factbases = instance.factbases;
-    std::vector<Edge>& edges = instance.edges;
+    EdgeList& edges = instance.edges;
+    const std::vector<Exploit>& exploits = instance.exploits;
     Keyvalue& factlist = instance.facts;
     struct timeval t1,t2;
 
@@ -549,11 +535,13 @@ void save_ag_to_db(AGGenInstance &instance, bool save_keyvalue){
             if (i == 0) {
                 factbase_sql_query += "(" + std::to_string(factbases[i].get_id()) +
                                       ",'" +
-                                      std::to_string(factbases[i].hash(factlist)) + "')";
+                                      std::to_string(factbases[i].hash()) + "'," +
+                                      std::to_string(factbases[i].get_depth()) + ")";
             } else {
                 factbase_sql_query += ",(" + std::to_string(factbases[i].get_id()) +
                                       ",'" +
-                                      std::to_string(factbases[i].hash(factlist)) + "')";
+                                      std::to_string(factbases[i].hash()) + "'," +
+                                      std::to_string(factbases[i].get_depth()) + ")";
             }
         }
         factbase_sql_query += ";";
@@ -577,12 +565,12 @@ void save_ag_to_db(AGGenInstance &instance, bool save_keyvalue){
             for (auto qi : quals) {
                 if (sql_index == 0)
                     quality_sql_query += "(" + std::to_string(id) + "," +
-                                         std::to_string(qi.get_encoding()) +
+                                         fact_to_string(qi) +
                                          ",'quality')";
 
                 else
                     quality_sql_query += ",(" + std::to_string(id) + "," +
-                                         std::to_string(qi.get_encoding()) +
+                                         fact_to_string(qi) +
                                          ",'quality')";
                 sql_index++;
             }
@@ -590,12 +578,12 @@ void save_ag_to_db(AGGenInstance &instance, bool save_keyvalue){
             for (auto ti : topo) {
                 if (sql_index == 0)
                     topology_sql_query += "(" + std::to_string(id) + "," +
-                                          std::to_string(ti.get_encoding()) +
+                                          fact_to_string(ti) +
                                           ",'topology')";
 
                 else
                     topology_sql_query += ",(" + std::to_string(id) + "," +
-                                          std::to_string(ti.get_encoding()) +
+                                          fact_to_string(ti) +
                                           ",'topology')";
                 sql_index++;
             }
@@ -613,61 +601,49 @@ void save_ag_to_db(AGGenInstance &instance, bool save_keyvalue){
 
     gettimeofday(&t1,NULL);
     if (!edges.empty()) {
-        std::vector<std::string> edge_queries;
-        edge_queries.resize(edges.size());
-        std::transform(edges.begin(), edges.end(), edge_queries.begin(), to_query);//to_query is a unary operation on all the elements in edges. It is defined in db_function.
-     
-        struct timeval t3,t4;
-        //---first way to build the map
-        std::unordered_map<std::string, int> eq;
-	gettimeofday(&t3,NULL);
-        auto ei = edge_queries.begin(); //returns an iterator, not the 1st element!
-        int j;
-        for (j = 0; ei != edge_queries.end(); j++, ei++){ 	
-            eq.insert({*ei, j});
-	}
-
-        	std::vector<std::string> unique_eq;
-	int unique_idx[eq.size()];
-	int jj=0;
-	for(auto ei: eq) {
-	    unique_eq.push_back(ei.first);
-	    unique_idx[jj]=ei.second;
-	    jj++;
-	}
-	gettimeofday(&t4,NULL);
-    	
-
-	struct timeval t5,t6;
-	gettimeofday(&t5,NULL);
-	for(int k=0;k<2;k++)
-	{
-        std::string edge_sql_query = "INSERT INTO edge VALUES ";
-        std::string edge_assets_sql_query = "INSERT INTO edge_asset_binding VALUES ";
-        for(int i=0;i<(jj/2)+((k==1)?(jj%2):0);i++){
-	    int idx=unique_idx[i+k*(jj/2)];
-	    int eid = edges[idx].get_id();
-            if(i==0){
-	    	edge_sql_query += "(" + std::to_string(eid) + "," + unique_eq[i+k*(jj/2)];
-                edge_assets_sql_query += edges[idx].get_asset_query();
-	    }
-	    else{
-                edge_sql_query += ",(" + std::to_string(eid) + "," + unique_eq[i+k*(jj/2)];
-                edge_assets_sql_query += "," + edges[idx].get_asset_query();		
-	    }
-	}	
-        edge_sql_query += ";";
-        edge_assets_sql_query += ";";
-        db.exec("BEGIN;");
-        db.execAsync(edge_sql_query);//33.7s
-        db.execAsync(edge_assets_sql_query); //7.6s
-	db.execAsync("COMMIT;");//this part only takes 0.5ms
+        // Duplicate edges are dropped during generation, so every stored edge
+        // is written as it is, in two chunks
+        size_t num_edges = edges.size();
+        for (int k = 0; k < 2; k++) {
+            size_t start = k * (num_edges / 2);
+            size_t end = (k == 0) ? num_edges / 2 : num_edges;
+            if (start == end)
+                continue;
+
+            std::string edge_sql_query = "INSERT INTO edge VALUES ";
+            std::string edge_assets_sql_query = "INSERT INTO edge_asset_binding VALUES ";
+            for (size_t i = start; i < end; i++) {
+                if (i != start) {
+                    edge_sql_query += ",";
+                    edge_assets_sql_query += ",";
+                }
+                edge_sql_query += "(" + std::to_string(edges.get_id(i)) + "," + edges.get_query(i, exploits);
+                edge_assets_sql_query += edges.get_asset_query(i, exploits);
+            }
+            edge_sql_query += ";";
+            edge_assets_sql_query += ";";
+            db.exec("BEGIN;");
+            db.execAsync(edge_sql_query);
+            db.execAsync(edge_assets_sql_query);
+            db.execAsync("COMMIT;");
         }
-	gettimeofday(&t6,NULL);
-	}
+    }
     gettimeofday(&t2,NULL);
     printf("The saving of edge and edge_asset_binding took %lf ms\n",(t2.tv_sec-t1.tv_sec)*1000.0+(t2.tv_usec-t1.tv_usec)/1000.0);//42.0s
 
+    if (!instance.unexpanded.empty()) {
+        std::string frontier_sql_query = "INSERT INTO frontier VALUES ";
+        for (size_t i = 0; i < instance.unexpanded.size(); i++) {
+            if (i != 0)
+                frontier_sql_query += ",";
+            frontier_sql_query += "(" + std::to_string(instance.unexpanded[i]) + ")";
+        }
+        frontier_sql_query += ";";
+        db.exec("BEGIN;");
+        db.execAsync(frontier_sql_query);
+        db.execAsync("COMMIT;");
+    }
+
     gettimeofday(&t1,NULL);
     db.exec("BEGIN;");
     int cnt1=0;
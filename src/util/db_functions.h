@@ -36,12 +36,10 @@ void import_models(std::string nm, std::string xp);
 
 GraphInfo fetch_graph_info();
 
-void delete_edges(std::vector<int> edge_ids);
-
 int get_max_factbase_id();
 
-std::vector<std::vector<std::pair<size_t, std::string>>> fetch_all_factbase_items();
-std::vector<std::pair<size_t, std::string>> fetch_one_factbase_items(int index);
+std::vector<std::vector<std::pair<Fact, std::string>>> fetch_all_factbase_items();
+std::vector<std::pair<Fact, std::string>> fetch_one_factbase_items(int index);
 
 std::vector<std::string> fetch_keyvalues();
 Keyvalue fetch_kv();
@@ -59,14 +57,12 @@ std::unordered_map<
                fetch_exploit_postconds();
 
 std::vector<Exploit> fetch_all_exploits();
-std::unordered_map<int, std::vector<Quality>> fetch_asset_qualities(Keyvalue &facts);
-std::vector<Asset> fetch_all_assets(Keyvalue &facts);
-std::vector<Quality> fetch_all_qualities(Keyvalue &facts);
-std::vector<Topology> fetch_all_topologies(Keyvalue &facts);
+std::unordered_map<int, std::vector<Quality>> fetch_asset_qualities(const Keyvalue &facts);
+std::vector<Asset> fetch_all_assets(const Keyvalue &facts);
+std::vector<Quality> fetch_all_qualities(const Keyvalue &facts);
+std::vector<Topology> fetch_all_topologies(const Keyvalue &facts);
 Keyvalue fetch_facts();
 
-inline std::string to_query(Edge edge) { return edge.get_query(); }
-
 // void save_ag_to_db(std::vector<FactbaseItems> &factbase_items,
 //                    std::vector<Factbase> &factbases, std::vector<Edge> &edges,
 //                    Keyvalue &factlist);
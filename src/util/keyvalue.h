@@ -1,61 +1,116 @@
 #ifndef KEYVALUE_HPP
 #define KEYVALUE_HPP
 
+#include <cmath>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
-#include <memory>
-#include <unordered_map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
+/** Keyvalue class
+ * @brief Interned table of every property and value name in a model
+ * @details Each distinct string gets a stable integer ID, its position in
+ *          the table, and the rest of the engine works with those IDs. The
+ *          table is filled by populate() and is read only afterwards: lookups
+ *          go through a flat open-addressing index of IDs, keyed by
+ *          std::string_view, so they never allocate. Strings that are numbers
+ *          are also parsed once, so values can be compared numerically.
+ */
 class Keyvalue {
-    int length{0};
-    std::unordered_map<std::string, int> hash_table;
     std::vector<std::string> str_vector;
+    std::vector<double> numbers; //!< Numeric value of each string, NaN if none
+    std::vector<int> index; //!< Open-addressing slots holding IDs, -1 if empty
 
-    template <typename U, typename = std::string>
-    struct can_get_name : std::false_type {};
+    static constexpr int EMPTY = -1;
 
-    template <typename U>
-    struct can_get_name<U, decltype(std::declval<U>().get_name())>
-        : std::true_type {};
+    static double parse_number(const std::string &str) {
+        const char *begin = str.c_str();
+        char *end = nullptr;
+        double value = std::strtod(begin, &end);
+        if (str.empty() || end != begin + str.size() || !std::isfinite(value))
+            return NAN;
+        return value;
+    }
+
+    static size_t hash(std::string_view str) { return std::hash<std::string_view>{}(str); }
+
+    /**
+     * @return The slot holding str, or the empty slot where it would go
+     */
+    size_t slot_of(std::string_view str) const {
+        size_t mask = index.size() - 1;
+        size_t slot = hash(str) & mask;
+        while (index[slot] != EMPTY && str_vector[index[slot]] != str)
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    /**
+     * @brief Rebuilds the index with at most half of the slots in use
+     */
+    void freeze() {
+        size_t slots = 16;
+        while (slots < str_vector.size() * 2)
+            slots *= 2;
+        index.assign(slots, EMPTY);
+        for (size_t i = 0; i < str_vector.size(); i++)
+            index[slot_of(str_vector[i])] = static_cast<int>(i);
+    }
 
   public:
-    Keyvalue() = default;
+    Keyvalue() { freeze(); }
 
-    void populate(std::vector<std::string> v) {//making a hashtable for all initial facts
+    /**
+     * @brief Interns every string of a vector and freezes the table
+     * @details Strings that are already known keep their ID, so calling
+     *          populate() again only appends new strings.
+     */
+    void populate(const std::vector<std::string> &v) {//making a hashtable for all initial facts
         for (auto &s : v) {
-            insert<std::string>(s);
+            if (find(s) == EMPTY) {
+                str_vector.push_back(s);
+                numbers.push_back(parse_number(s));
+                if (str_vector.size() * 2 > index.size())
+                    freeze();
+                else
+                    index[slot_of(s)] = static_cast<int>(str_vector.size() - 1);
+            }
         }
-        //for (const auto &abc: hash_table){
-        //    std::cout<<"Key: "<<abc.first<<" Value: "<<abc.second<<"\n";
-        //}
-        //for(std::string abc: str_vector){
-         //   std::cout<<abc<<"\n";
-        //}
     }
 
-    template <typename U>
-    typename std::enable_if<can_get_name<U>::value, void>::type
-    insert(U &target) {
-        hash_table[target.get_name()] = length;
-        str_vector.push_back(target.get_name());
-        length++;
+    /**
+     * @return The ID of str, or -1 if it is not in the table
+     */
+    int find(std::string_view str) const {
+        return index[slot_of(str)];
     }
 
-    template <typename U> //This is the method (template) to be called by populate().
-    typename std::enable_if<!can_get_name<U>::value, void>::type
-    insert(U &target) {
-        hash_table[target] = length; //each target get a position in the unordered_map (like python's dictionary)
-        str_vector.push_back(target); //each target also is put in str_vector for other purposes;
-        length++;
+    int operator[](std::string_view str) const {  //the so-called operator overloading. When access the hash number of a string, just use obj["string name"].
+        int id = find(str);
+        if (id == EMPTY)
+            throw std::out_of_range("Keyvalue: unknown fact " + std::string(str));
+        return id;
     }
 
-    int operator[](const std::string &str) const { return hash_table.at(str); }  //the so-called operator overloading. When access the hash number of a string, just use obj["string name"].
+    const std::string &operator[](int num) const { return str_vector.at(num); }
+
+    /**
+     * @return True if the string with the given ID is a number
+     */
+    bool is_number(int num) const { return !std::isnan(numbers.at(num)); }
 
-    std::string operator[](int num) const { return str_vector.at(num); }
+    /**
+     * @return The numeric value of the string with the given ID, NaN if it is
+     *         not a number
+     */
+    double number(int num) const { return numbers.at(num); }
 
-    int size() const { return length; }
+    int size() const { return static_cast<int>(str_vector.size()); }
 
-    std::vector<std::string> get_str_vector() { return str_vector; }
+    const std::vector<std::string> &get_str_vector() const { return str_vector; }
 };
 
 #endif // KEYVALUE_HPP
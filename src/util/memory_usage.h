@@ -0,0 +1,29 @@
+#ifndef UTIL_MEMORY_USAGE_H
+#define UTIL_MEMORY_USAGE_H
+
+#include <cstddef>
+#include <cstdio>
+
+#include <unistd.h>
+
+/**
+ * @brief Resident memory of this process
+ * @details Read from /proc/self/statm, which takes a system call, so callers
+ *          on a hot path should sample it rather than call it every time.
+ *
+ * @return The resident set size in bytes, or 0 where /proc is not available
+ */
+inline size_t resident_memory() {
+    FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    int read = std::fscanf(statm, "%lu %lu", &size, &resident);
+    std::fclose(statm);
+    if (read != 2)
+        return 0;
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+#endif // UTIL_MEMORY_USAGE_H
@@ -1,15 +1,27 @@
 #ifdef REDIS
 
-#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
 #include <string>
 #include <vector>
-#include <algorithm>
 #include <cpp_redis/cpp_redis>
 
-#include "ag_gen/quality.h"
-#include "ag_gen/topology.h"
 #include "redis_manager.h"
 
+// Keys of the visited set, as the insert_or_get script uses them
+static const std::vector<std::string> VISITED_KEYS{"visited", "next_id", "collisions", "pending"};
+// Keys of the work list, as the take_work script uses them
+static const std::vector<std::string> WORK_KEYS{"work", "pending", "stop"};
+static const std::string EDGE_ID_KEY = "next_edge_id";
+
+/**
+ * @brief Connects to Redis and loads the server-side scripts
+ *
+ * @param sm Script names and their Lua source. insert_or_get() and
+ *           take_work() need the scripts named after them.
+ */
 RedisManager::RedisManager(std::string host, int port,
                            std::vector<std::pair<std::string, std::string>> &sm) {
     client.connect(host, port);
@@ -21,21 +33,131 @@ RedisManager::RedisManager(std::string host, int port,
     }
 }
 
-void RedisManager::insert_factbase(std::string &hash, int id) {
-    client.sadd("factbases", std::vector<std::string>{hash});
-    client.hset("idmap:" + hash, "id", std::to_string(id));
+/**
+ * @brief Looks a batch of states up and claims the ones not in the set
+ * @details One round trip for the whole batch. A state that appears twice in
+ *          a batch is claimed by its first appearance.
+ *
+ * @param states The first and second hash of every state, the second made
+ *               with CHECK_SEED
+ * @return For every state, its ID and whether this call claimed it
+ */
+std::vector<std::pair<int, bool>>
+RedisManager::insert_or_get(const std::vector<std::pair<size_t, size_t>> &states) {
+    auto script = script_map.find("insert_or_get");
+    if (script == script_map.end())
+        throw std::logic_error("The insert_or_get script was not loaded");
+
+    std::vector<std::future<cpp_redis::reply>> replies;
+    std::vector<std::string> args;
+    for (size_t first = 0; first < states.size(); first += STATES_PER_CALL) {
+        size_t last = std::min(states.size(), first + STATES_PER_CALL);
+        args.clear();
+        for (size_t i = first; i < last; i++) {
+            args.push_back(std::to_string(states[i].first));
+            args.push_back(std::to_string(states[i].second));
+        }
+        replies.push_back(client.evalsha(script->second, static_cast<int>(VISITED_KEYS.size()),
+                                         VISITED_KEYS, args));
+    }
+    commit();
+
+    std::vector<std::pair<int, bool>> ids;
+    ids.reserve(states.size());
+    for (auto &future : replies) {
+        cpp_redis::reply r = future.get();
+        if (r.is_error())
+            throw std::runtime_error("Redis insert_or_get failed: " + r.as_string());
+        const auto &values = r.as_array();
+        for (size_t i = 0; i + 1 < values.size(); i += 2)
+            ids.emplace_back(static_cast<int>(values[i].as_integer()), values[i + 1].as_integer() == 1);
+    }
+    if (ids.size() != states.size())
+        throw std::runtime_error("Redis insert_or_get returned the wrong number of IDs");
+    return ids;
 }
 
-int RedisManager::get_factbase_id(std::string &hash) {
-    auto r = client.hget("idmap:" + hash, "id");
+/**
+ * @brief Hands in the states a process claimed and expanded, and takes more
+ * @details One round trip. Every process of a run calls it in a loop until
+ *          it returns true; taking no states only means that the others are
+ *          still expanding theirs.
+ *
+ * @param claimed The states claimed since the last call, to be expanded
+ * @param expanded How many states were expanded since the last call
+ * @param count The most states to take
+ * @param limit The limit this process reached, or empty. It stops the run
+ *              for every process.
+ * @param taken Set to the states taken
+ * @param reason Set to the limit that stopped the run, if one did
+ * @return Whether the run is over
+ */
+bool RedisManager::take_work(const std::vector<std::string> &claimed, size_t expanded, size_t count,
+                             const std::string &limit, std::vector<std::string> &taken,
+                             std::string &reason) {
+    auto script = script_map.find("take_work");
+    if (script == script_map.end())
+        throw std::logic_error("The take_work script was not loaded");
+
+    std::vector<std::string> args{std::to_string(expanded), std::to_string(count), limit};
+    args.insert(args.end(), claimed.begin(), claimed.end());
+    auto future = client.evalsha(script->second, static_cast<int>(WORK_KEYS.size()), WORK_KEYS, args);
     commit();
-    return std::stoi(r.get().as_string());
+
+    cpp_redis::reply r = future.get();
+    if (r.is_error())
+        throw std::runtime_error("Redis take_work failed: " + r.as_string());
+    const auto &values = r.as_array();
+    const std::string &status = values.at(0).as_string();
+    taken.clear();
+    if (status == "stop") {
+        reason = values.at(1).as_string();
+        return true;
+    }
+    for (size_t i = 1; i < values.size(); i++)
+        taken.push_back(values[i].as_string());
+    return status == "done";
+}
+
+/**
+ * @return The states still waiting in the work list, which no process takes
+ *         once a limit stopped the run
+ */
+std::vector<std::string> RedisManager::waiting() {
+    auto future = client.lrange(WORK_KEYS[0], 0, -1);
+    commit();
+
+    cpp_redis::reply r = future.get();
+    if (r.is_error())
+        throw std::runtime_error("Redis lrange failed: " + r.as_string());
+    std::vector<std::string> states;
+    for (const auto &value : r.as_array())
+        states.push_back(value.as_string());
+    return states;
+}
+
+/**
+ * @brief Reserves a range of edge IDs no other process of the run gets
+ * @return The first ID of the range
+ */
+int RedisManager::reserve_edge_ids(size_t count) {
+    auto future = client.incrby(EDGE_ID_KEY, static_cast<int>(count));
+    commit();
+
+    cpp_redis::reply r = future.get();
+    if (r.is_error())
+        throw std::runtime_error("Redis incrby failed: " + r.as_string());
+    return static_cast<int>(r.as_integer() - static_cast<int64_t>(count));
 }
 
-bool RedisManager::check_factbase_exists(std::string &hash) {
-    auto r = client.sismember("factbases", hash);
+/**
+ * @brief Empties the visited set and the work list and restarts every ID at 0
+ */
+void RedisManager::clear() {
+    std::vector<std::string> keys = VISITED_KEYS;
+    keys.insert(keys.end(), {WORK_KEYS[0], WORK_KEYS[2], EDGE_ID_KEY});
+    client.del(keys);
     commit();
-    return r.get().as_integer() == 1;
 }
 
 #endif
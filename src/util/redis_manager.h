@@ -6,41 +6,53 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <utility>
 #include <cpp_redis/cpp_redis>
 
-#include "ag_gen/quality.h"
-
+/** RedisManager class
+ * @brief Visited-state set and work list kept in Redis, shared by every
+ *        process that uses it
+ * @details A state is identified by two independent hashes of its facts. The
+ *          insert_or_get script (redis_scripts/insert_or_get.lua) claims
+ *          states that are not in the set yet and hands out their IDs from a
+ *          shared counter, all in one atomic step. A state whose first hash
+ *          collides with another state's is told apart by its second hash
+ *          and gets its own ID.
+ *
+ *          Lookups are made for whole batches of states: the script calls of
+ *          a batch are pipelined and committed together, so a batch costs a
+ *          single round trip to the server.
+ *
+ *          Claimed states are expanded by whichever process takes them from
+ *          the shared work list next (redis_scripts/take_work.lua), which
+ *          also counts the claimed states not expanded yet, so every process
+ *          learns when the run is over. Edge IDs come from another shared
+ *          counter.
+ */
 class RedisManager {
     cpp_redis::client client;
 
     std::unordered_map<std::string, std::string> script_map;
 
-    // std::string insert_collision_factbase(std::string &hash, int id);
-
   public:
+    //! Seed of the second hash of a state, see Factbase::hash()
+    static constexpr size_t CHECK_SEED = 0x9e3779b97f4a7c15ULL;
+    //! States per script call, to keep each call short on the server
+    static constexpr size_t STATES_PER_CALL = 1024;
+
     RedisManager() {}
     RedisManager(std::string host, int port, std::vector<std::pair<std::string, std::string>> &sm);
 
-    // void insert_facts(std::string &hash, std::vector<Quality> &quals, std::vector<Topology> &topos);
-    void insert_factbase(std::string &hash, int id);
-
-    void handle_collision(std::string &hash, int id, std::vector<Quality> &quals, std::vector<Topology> &topos);
-
-    // int get_factbase_id(std::string &hash, int ci);
+    std::vector<std::pair<int, bool>> insert_or_get(const std::vector<std::pair<size_t, size_t>> &states);
 
-    int get_factbase_id(std::string &hash);
-
-    // int get_collision_count(std::string &hash);
-
-    // bool check_facts(std::string &hash, const std::vector<Quality> &quals, const std::vector<Topology> &topos);
-    bool check_factbase_exists(std::string &hash);
-
-    // bool check_collision(std::string &hash);
+    bool take_work(const std::vector<std::string> &claimed, size_t expanded, size_t count,
+                   const std::string &limit, std::vector<std::string> &taken, std::string &reason);
+    std::vector<std::string> waiting();
+    int reserve_edge_ids(size_t count);
 
     inline void commit() { client.sync_commit(); }
 
-    inline void clear() { client.flushall(); commit(); }
-
+    void clear();
 };
 
 #endif
@@ -0,0 +1,139 @@
+#ifndef UTIL_THREAD_POOL_H
+#define UTIL_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/** ThreadPool class
+ * @brief A fixed set of threads that run parallel loops
+ * @details run() hands out the tasks 0..n-1 to the pool threads and to the
+ *          calling thread, which takes part as worker 0, and returns once
+ *          every task has finished. Tasks are claimed one at a time from an
+ *          atomic counter, so uneven tasks balance themselves. Each task is
+ *          also given the index of the worker running it, so it can use
+ *          per-worker scratch space without locking.
+ *
+ *          The threads sleep between calls to run() and are joined when the
+ *          pool is destroyed.
+ */
+class ThreadPool {
+    // The loop body of the current run(), called through a plain function
+    // pointer so that run() never allocates
+    using Task = void (*)(void *body, size_t task, size_t worker);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    Task task = nullptr;
+    void *body = nullptr;
+    size_t num_tasks = 0;
+    std::atomic<size_t> next_task{0};
+    size_t round = 0;   //!< Incremented by every call to run()
+    size_t busy = 0;    //!< Pool threads still working on the current round
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void work(size_t worker) {
+        size_t i;
+        while ((i = next_task++) < num_tasks) {
+            try {
+                task(body, i, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+
+    void loop(size_t worker) {
+        size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || round != seen; });
+                if (stopping)
+                    return;
+                seen = round;
+            }
+            work(worker);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0)
+                done.notify_one();
+        }
+    }
+
+  public:
+    /**
+     * @param workers The number of workers, including the calling thread
+     */
+    explicit ThreadPool(size_t workers) {
+        for (size_t i = 1; i < workers; i++)
+            threads.emplace_back(&ThreadPool::loop, this, i);
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    /**
+     * @return The number of workers, including the calling thread
+     */
+    size_t size() const { return threads.size() + 1; }
+
+    /**
+     * @brief Runs fn(task, worker) for every task in [0, n) and waits for all
+     * @details If a task throws, the remaining tasks still run and the first
+     *          exception is rethrown here.
+     */
+    template <typename Fn>
+    void run(size_t n, Fn &&fn) {
+        if (threads.empty() || n <= 1) {
+            for (size_t i = 0; i < n; i++)
+                fn(i, size_t{0});
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = [](void *b, size_t i, size_t worker) {
+                (*static_cast<std::remove_reference_t<Fn> *>(b))(i, worker);
+            };
+            body = const_cast<void *>(static_cast<const void *>(&fn));
+            num_tasks = n;
+            next_task = 0;
+            busy = threads.size();
+            round++;
+        }
+        wake.notify_all();
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return busy == 0; });
+        task = nullptr;
+        body = nullptr;
+        if (error) {
+            auto e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+};
+
+#endif // UTIL_THREAD_POOL_H
@@ -0,0 +1,209 @@
+#ifndef UTIL_VISITED_TABLE_H
+#define UTIL_VISITED_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+
+/** VisitedTable class
+ * @brief Concurrent map from state hashes to state IDs
+ * @details insert_or_get() either claims a hash and gives it a new ID or
+ *          returns the ID it already has, in one probe sequence, and is safe
+ *          to call from any number of threads.
+ *
+ *          Hashes are spread over 64 shards, each an open-addressing table
+ *          with linear probing. Inserting into a shard is lock free: a slot
+ *          is claimed by a compare-and-swap on its key, and the ID is
+ *          published right after. A thread that finds the key before its ID
+ *          is published waits for it. Each shard also has a readers-writer
+ *          lock. Inserts only hold it shared, and a shard takes it exclusively
+ *          only while it doubles, which happens when it is half full. Size
+ *          the table with reserve() to avoid doubling altogether.
+ */
+class VisitedTable {
+    static constexpr int EMPTY = -2;
+    static constexpr int PENDING = -1;
+    static constexpr int SHARD_BITS = 6;
+    static constexpr size_t NUM_SHARDS = size_t{1} << SHARD_BITS;
+    static constexpr size_t MIN_SLOTS = 16;
+
+    struct Slot {
+        std::atomic<uint64_t> key{0}; //!< Mixed hash, 0 if the slot is free
+        std::atomic<int> id{PENDING};
+    };
+
+    struct alignas(64) Shard {
+        std::shared_mutex lock;
+        std::unique_ptr<Slot[]> slots;
+        size_t mask = 0;
+        std::atomic<size_t> count{0};
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<int> zero_id{EMPTY}; //!< ID of the hash that mixes to 0
+
+    /**
+     * @brief Spreads a hash over all bits, one to one
+     */
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    }
+
+    static int wait_for(const std::atomic<int> &id) {
+        int value;
+        while ((value = id.load(std::memory_order_acquire)) == PENDING)
+            std::this_thread::yield();
+        return value;
+    }
+
+    static void resize(Shard &shard, size_t num_slots) {
+        std::unique_ptr<Slot[]> slots(new Slot[num_slots]);
+        size_t mask = num_slots - 1;
+        for (size_t i = 0; shard.slots && i <= shard.mask; i++) {
+            uint64_t key = shard.slots[i].key.load(std::memory_order_relaxed);
+            if (key == 0)
+                continue;
+            size_t j = key & mask;
+            while (slots[j].key.load(std::memory_order_relaxed) != 0)
+                j = (j + 1) & mask;
+            slots[j].key.store(key, std::memory_order_relaxed);
+            slots[j].id.store(shard.slots[i].id.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        shard.slots = std::move(slots);
+        shard.mask = mask;
+    }
+
+    /**
+     * @brief Doubles a shard if it is at least half full, or if force is set
+     */
+    static void grow(Shard &shard, bool force) {
+        std::unique_lock<std::shared_mutex> write(shard.lock);
+        if (force || shard.count.load(std::memory_order_relaxed) * 2 > shard.mask + 1)
+            resize(shard, (shard.mask + 1) * 2);
+    }
+
+  public:
+    /**
+     * @param expected The number of hashes the table should hold without
+     *                 growing
+     */
+    explicit VisitedTable(size_t expected = 0) : shards(new Shard[NUM_SHARDS]) {
+        for (size_t s = 0; s < NUM_SHARDS; s++)
+            resize(shards[s], MIN_SLOTS);
+        reserve(expected);
+    }
+
+    VisitedTable(const VisitedTable &) = delete;
+    VisitedTable &operator=(const VisitedTable &) = delete;
+
+    /**
+     * @brief Grows the table to hold expected hashes without doubling
+     * @details Not safe to call while other threads use the table.
+     */
+    void reserve(size_t expected) {
+        // Half full at most, plus some room for an uneven spread
+        size_t per_shard = expected / NUM_SHARDS * 2 + expected / NUM_SHARDS / 2;
+        for (size_t s = 0; s < NUM_SHARDS; s++) {
+            size_t num_slots = shards[s].mask + 1;
+            while (num_slots < per_shard)
+                num_slots *= 2;
+            if (num_slots != shards[s].mask + 1)
+                resize(shards[s], num_slots);
+        }
+    }
+
+    /**
+     * @brief Looks a hash up and adds it if it is not there
+     *
+     * @param hash The hash of a state
+     * @param make_id Called to get the ID of a new hash, exactly once, by the
+     *                thread that adds it
+     * @return The ID of the hash, and whether this call added it
+     */
+    template <typename MakeId>
+    std::pair<int, bool> insert_or_get(size_t hash, MakeId &&make_id) {
+        uint64_t key = mix(hash);
+        if (key == 0) {
+            int expected = EMPTY;
+            if (zero_id.compare_exchange_strong(expected, PENDING, std::memory_order_acq_rel)) {
+                int id = make_id();
+                zero_id.store(id, std::memory_order_release);
+                return {id, true};
+            }
+            return {wait_for(zero_id), false};
+        }
+
+        Shard &shard = shards[key >> (64 - SHARD_BITS)];
+        while (true) {
+            std::shared_lock<std::shared_mutex> read(shard.lock);
+            Slot *slots = shard.slots.get();
+            size_t mask = shard.mask;
+            size_t i = key & mask;
+            for (size_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask) {
+                uint64_t found = slots[i].key.load(std::memory_order_acquire);
+                if (found == 0) {
+                    if (slots[i].key.compare_exchange_strong(found, key, std::memory_order_acq_rel,
+                                                             std::memory_order_acquire)) {
+                        int id = make_id();
+                        slots[i].id.store(id, std::memory_order_release);
+                        bool half_full = (shard.count.fetch_add(1, std::memory_order_relaxed) + 1) * 2 > mask + 1;
+                        read.unlock();
+                        if (half_full)
+                            grow(shard, false);
+                        return {id, true};
+                    }
+                    // Lost the slot, found now holds the key that won it
+                }
+                if (found == key)
+                    return {wait_for(slots[i].id), false};
+            }
+            // Every slot was claimed before the shard could grow
+            read.unlock();
+            grow(shard, true);
+        }
+    }
+
+    /**
+     * @return The ID of a hash, or -1 if it is not in the table
+     */
+    int find(size_t hash) {
+        uint64_t key = mix(hash);
+        if (key == 0) {
+            int id = zero_id.load(std::memory_order_acquire);
+            return id == EMPTY ? -1 : wait_for(zero_id);
+        }
+        Shard &shard = shards[key >> (64 - SHARD_BITS)];
+        std::shared_lock<std::shared_mutex> read(shard.lock);
+        size_t i = key & shard.mask;
+        for (size_t probes = 0; probes <= shard.mask; probes++, i = (i + 1) & shard.mask) {
+            uint64_t found = shard.slots[i].key.load(std::memory_order_acquire);
+            if (found == 0)
+                return -1;
+            if (found == key)
+                return wait_for(shard.slots[i].id);
+        }
+        return -1;
+    }
+
+    /**
+     * @return The number of hashes in the table
+     */
+    size_t size() const {
+        size_t n = zero_id.load(std::memory_order_relaxed) == EMPTY ? 0 : 1;
+        for (size_t s = 0; s < NUM_SHARDS; s++)
+            n += shards[s].count.load(std::memory_order_relaxed);
+        return n;
+    }
+};
+
+#endif // UTIL_VISITED_TABLE_H
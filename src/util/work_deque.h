@@ -0,0 +1,136 @@
+#ifndef UTIL_WORK_DEQUE_H
+#define UTIL_WORK_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/** WorkDeque class
+ * @brief Chase-Lev work-stealing deque
+ * @details The owning thread pushes and takes work at the bottom without
+ *          locking; any other thread steals from the top with a single
+ *          compare-and-swap. The owner can also take from the top, which
+ *          makes its own order first-in first-out. T must be trivially
+ *          copyable, typically a pointer, and a null T means no work.
+ *
+ *          The ring buffer doubles when it is full. Replaced buffers are kept
+ *          until the deque is destroyed, since a thief may still be reading
+ *          from one.
+ *
+ *          Follows Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+ *          Work-Stealing for Weak Memory Models", PPoPP 2013.
+ */
+template <typename T>
+class WorkDeque {
+    struct Ring {
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Ring(int64_t size) : mask(size - 1), slots(new std::atomic<T>[size]) {}
+
+        int64_t size() const { return mask + 1; }
+        T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T x) { slots[i & mask].store(x, std::memory_order_relaxed); }
+    };
+
+    // Owner and thieves touch different ends, so keep them on separate lines
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<Ring *> ring;
+    std::vector<std::unique_ptr<Ring>> rings; //!< Every buffer ever used, owner only
+
+    Ring *grow(Ring *old, int64_t t, int64_t b) {
+        rings.emplace_back(new Ring(old->size() * 2));
+        Ring *bigger = rings.back().get();
+        for (int64_t i = t; i < b; i++)
+            bigger->put(i, old->get(i));
+        ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+  public:
+    explicit WorkDeque(int64_t capacity = 1024) {
+        int64_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        rings.emplace_back(new Ring(size));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkDeque(const WorkDeque &) = delete;
+    WorkDeque &operator=(const WorkDeque &) = delete;
+
+    /**
+     * @brief Adds work at the bottom. Owner only.
+     */
+    void push(T x) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring *r = ring.load(std::memory_order_relaxed);
+        if (b - t > r->size() - 1)
+            r = grow(r, t, b);
+        r->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Takes the newest work. Owner only.
+     * @return The work, or a null T if the deque is empty
+     */
+    T take() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring *r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        T x{};
+        if (t <= b) {
+            x = r->get(b);
+            if (t == b) {
+                // Last item: race the thieves for it
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed))
+                    x = T{};
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    /**
+     * @brief Takes the oldest work. Safe from any thread.
+     * @return The work, or a null T if the deque is empty or another thread
+     *         won the race for it
+     */
+    T steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return T{};
+
+        Ring *r = ring.load(std::memory_order_acquire);
+        T x = r->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return T{};
+        return x;
+    }
+
+    /**
+     * @return Roughly how much work is queued, exact when no thread is
+     *         pushing or taking
+     */
+    int64_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+};
+
+#endif // UTIL_WORK_DEQUE_H